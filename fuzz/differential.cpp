@@ -0,0 +1,25 @@
+#include "oracle.hpp"
+
+#include "../include/analyzers.hpp"
+#include "../include/diagnostics.hpp"
+#include "../include/source.hpp"
+
+#include <cstdint>
+#include <string_view>
+
+// analyzer::lex against fuzz::reference_lex; swap in any new lexer here before rolling it out.
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size)
+{
+  fuzz::reset_identifiers();
+
+  const auto source = std::string_view(reinterpret_cast<const char*>(data), size);
+  const auto lines  = src::LineIndex{source};
+
+  auto diagnostics = diag::Sink{0, lines};
+  const auto actual   = analyzer::lex(source, diagnostics);
+  const auto expected = fuzz::reference_lex(source);
+
+  fuzz::expect_equivalent(expected, actual);
+
+  return 0;
+}
@@ -0,0 +1,36 @@
+#include "oracle.hpp"
+
+#include "../include/analyzers.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// int_num_kw and float_num_kw straight against std::from_chars. Bytes other
+// than digits and '.' are folded onto them, so every input exercises the
+// SWAR digit scan and the float paths instead of being rejected early.
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size)
+{
+  constexpr auto alphabet = std::string_view{"0123456789."};
+
+  auto lexeme = std::string(reinterpret_cast<const char*>(data), size);
+  for (auto& ch : lexeme)
+  {
+    if (not alphabet.contains(ch))
+    {
+      ch = alphabet[static_cast<unsigned char>(ch) % alphabet.size()];
+    }
+  }
+
+  if (auto match = analyzer::int_num_kw(lexeme); match and match->length == lexeme.size())
+  {
+    fuzz::expect_value<std::uint64_t>(lexeme, *match);
+  }
+
+  if (auto match = analyzer::float_num_kw(lexeme); match and match->length == lexeme.size())
+  {
+    fuzz::expect_value<double>(lexeme, *match);
+  }
+
+  return 0;
+}
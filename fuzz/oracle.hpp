@@ -0,0 +1,212 @@
+#pragma once
+
+#include "reference.hpp"
+
+#include "../include/analyzers.hpp"
+#include "../include/suggest.hpp"
+#include "../include/tokens.hpp"
+#include "../include/utf8.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <concepts>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace fuzz
+{
+
+  // Starts every input from an empty identifier table so symbol numbers only
+  // depend on the input itself and the table does not grow across runs.
+  inline void reset_identifiers()
+  {
+    analyzer::reset_identifiers();
+  }
+
+  // Scalar UTF-8 check, one code point at a time: the offset of the first
+  // ill-formed sequence, as utf8::validate reports it, or nullopt.
+  inline auto first_invalid(std::string_view text) -> std::optional<std::size_t>
+  {
+    for (auto index = std::size_t{0}; index < text.size(); )
+    {
+      if (not utf8::decode(text, index))
+      {
+        return index;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // For lexemes no recognizer takes; utf8::validate is what the lexer uses.
+  inline auto well_formed(std::string_view lexeme) -> bool
+  {
+    return not first_invalid(lexeme);
+  }
+
+  // The reference tokenization: the original line/space split with every
+  // lexeme handed to the frozen recognizers of reference.hpp in order, and
+  // identifiers numbered from 1 in order of first occurrence. Any faster
+  // lexer must produce exactly this sequence.
+  inline auto reference_lex(std::string_view source) -> std::vector<tks::Spanned>
+  {
+    auto tokens  = std::vector<tks::Spanned>{};
+    auto symbols = std::unordered_map<std::string, std::uint32_t>{};
+
+    for (auto line : source | stdv::split('\n'))
+    {
+      for (auto piece : line | stdv::split(' '))
+      {
+        if (stdr::empty(piece))
+        {
+          continue;
+        }
+
+        const auto lexeme = std::string(stdr::begin(piece), stdr::end(piece));
+        const auto span   = tks::Span
+        {
+          .offset = static_cast<std::uint32_t>(&*stdr::begin(piece) - source.data()),
+          .length = static_cast<std::uint32_t>(lexeme.size())
+        };
+
+        auto token = Token{well_formed(lexeme) ? tks::Error{} : tks::Error{tks::Fault::InvalidEncoding}};
+        for (auto recognizer : reference::recognizers)
+        {
+          if (auto res = recognizer(lexeme))
+          {
+            token = *res;
+            break;
+          }
+        }
+
+        if (auto* id = std::get_if<tks::Id>(&token))
+        {
+          id->symbol = symbols.try_emplace(lexeme, static_cast<std::uint32_t>(symbols.size() + 1)).first->second;
+        }
+
+        tokens.push_back({token, span});
+      }
+    }
+
+    return tokens;
+  }
+
+  // Same kind, position and payload: symbol numbers, pooled literals (equal
+  // indices mean bit-identical values) and error faults all have to agree.
+  [[nodiscard]]
+  inline auto equivalent(const tks::Spanned& a, const tks::Spanned& b) -> bool
+  {
+    if (not tks::same(a, b))
+    {
+      return false;
+    }
+
+    if (const auto* error = std::get_if<tks::Error>(&a.token))
+    {
+      return error->fault == std::get<tks::Error>(b.token).fault;
+    }
+    if (const auto* number = std::get_if<tks::IntNum>(&a.token))
+    {
+      return number->literal == std::get<tks::IntNum>(b.token).literal;
+    }
+    if (const auto* number = std::get_if<tks::FloatNum>(&a.token))
+    {
+      return number->literal == std::get<tks::FloatNum>(b.token).literal;
+    }
+    return true;
+  }
+
+  // Textbook edit distance, the full table with no cut-offs.
+  inline auto levenshtein(std::string_view a, std::string_view b) -> std::int32_t
+  {
+    auto table = std::vector<std::vector<std::int32_t>>(a.size() + 1, std::vector<std::int32_t>(b.size() + 1));
+    for (auto i : range(0uz, a.size() + 1))
+    {
+      table[i][0] = static_cast<std::int32_t>(i);
+    }
+    for (auto j : range(0uz, b.size() + 1))
+    {
+      table[0][j] = static_cast<std::int32_t>(j);
+    }
+    for (auto i : range(1uz, a.size() + 1))
+    {
+      for (auto j : range(1uz, b.size() + 1))
+      {
+        table[i][j] = std::min({table[i - 1][j] + 1, table[i][j - 1] + 1, table[i - 1][j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1)});
+      }
+    }
+    return table[a.size()][b.size()];
+  }
+
+  // What suggest::Index::nearest has to answer: every word scanned in key
+  // order, the closest within `tolerance` kept, the first key on a tie.
+  inline auto nearest(const std::vector<std::string_view>& words, std::string_view word, std::int32_t tolerance) -> std::optional<suggest::Index::Match>
+  {
+    auto best = std::optional<suggest::Index::Match>{};
+    for (auto key : range(0uz, words.size()))
+    {
+      if (const auto distance = levenshtein(words[key], word); distance <= tolerance and (not best or distance < best->distance))
+      {
+        best = suggest::Index::Match{.key = key + 1, .distance = distance};
+      }
+    }
+    return best;
+  }
+
+  // Aborts unless a full-length number match carries what std::from_chars
+  // makes of the same lexeme, or OutOfRange where from_chars gives up.
+  template<typename T>
+  inline void expect_value(std::string_view lexeme, const analyzer::Match& match)
+  {
+    auto value = T{};
+    const auto [end, ec] = std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), value);
+
+    if (ec != std::errc{})
+    {
+      if (const auto* error = std::get_if<tks::Error>(&match.token); error and error->fault == tks::Fault::OutOfRange)
+      {
+        return;
+      }
+      std::println(stderr, "[Error] \"{}\" is out of range, got {}", lexeme, tks::to_string(match.token));
+      std::abort();
+    }
+
+    const auto expected = std::floating_point<T> ? constants::Literal::real(static_cast<double>(value)) : constants::Literal::integer(static_cast<std::uint64_t>(value));
+    const auto kind     = std::floating_point<T> ? std::holds_alternative<tks::FloatNum>(match.token) : std::holds_alternative<tks::IntNum>(match.token);
+
+    if (not kind or match.literal != expected)
+    {
+      std::println(stderr, "[Error] \"{}\" is {}, got bits {:#x}", lexeme, value, match.literal.bits);
+      std::abort();
+    }
+  }
+
+  // Aborts with the first mismatch so libFuzzer keeps the input as a crash.
+  inline void expect_equivalent(const std::vector<tks::Spanned>& expected, const std::vector<tks::Spanned>& actual)
+  {
+    for (auto index : range(0uz, std::min(expected.size(), actual.size())))
+    {
+      if (not equivalent(expected[index], actual[index]))
+      {
+        std::println(stderr, "[Error] token {} differs: expected {} at {}+{}, got {} at {}+{}",
+            index,
+            tks::to_string(expected[index].token), expected[index].span.offset, expected[index].span.length,
+            tks::to_string(actual[index].token),   actual[index].span.offset,   actual[index].span.length);
+        std::abort();
+      }
+    }
+
+    if (expected.size() != actual.size())
+    {
+      std::println(stderr, "[Error] expected {} tokens, got {}", expected.size(), actual.size());
+      std::abort();
+    }
+  }
+
+}
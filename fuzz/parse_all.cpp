@@ -0,0 +1,22 @@
+#include "oracle.hpp"
+
+#include "../include/analyzers.hpp"
+#include "../include/diagnostics.hpp"
+#include "../include/source.hpp"
+
+#include <cstdint>
+#include <string>
+
+// A single lexeme straight into analyzer::parse_all, recovery path included.
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size)
+{
+  fuzz::reset_identifiers();
+
+  auto lexeme      = std::string(reinterpret_cast<const char*>(data), size);
+  auto lines       = src::LineIndex{lexeme};
+  auto diagnostics = diag::Sink{1, lines};
+
+  [[maybe_unused]] auto token = analyzer::parse_all(lexeme, {0, static_cast<std::uint32_t>(size)}, diagnostics);
+
+  return 0;
+}
@@ -0,0 +1,31 @@
+#include "oracle.hpp"
+
+#include "../include/analyzers.hpp"
+#include "../include/diagnostics.hpp"
+#include "../include/source.hpp"
+
+#include <cstdint>
+#include <sstream>
+#include <string_view>
+
+// The whole-file path of main.cpp: line index, lexing, token and diagnostic output.
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size)
+{
+  fuzz::reset_identifiers();
+
+  const auto source = std::string_view(reinterpret_cast<const char*>(data), size);
+  const auto lines  = src::LineIndex{source};
+
+  auto diagnostics = diag::Sink{4, lines};
+  auto tokens      = analyzer::lex(source, diagnostics);
+
+  auto out = std::ostringstream{};
+  for (const auto& [token, span] : tokens)
+  {
+    const auto [line, column] = lines.location(span.offset);
+    std::print(out, "{}:{} {} ", line, column, tks::to_string(token));
+  }
+  diagnostics.flush(out);
+
+  return 0;
+}
@@ -0,0 +1,1369 @@
+#pragma once
+
+#include "../include/constants.hpp"
+#include "../include/tokens.hpp"
+#include "../include/utf8.hpp"
+
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <concepts>
+#include <expected>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+using namespace std::literals;
+
+#if not defined(constant)
+#define constant static constexpr auto
+#endif
+
+// The per-lexeme recognizers as they were before the lexer was rewritten
+// for speed, kept frozen as the oracle for fuzz/differential.cpp. Do not
+// optimize these: they are only worth anything while they stay the simple,
+// obviously correct version. Changes since the freeze are the ones the
+// language itself went through, and are marked:
+//   - identifiers are numbered by the caller instead of a global table,
+//   - number values come from std::from_chars on the whole lexeme, and a
+//     literal out of range is an error token instead of saturating,
+//   - identifiers accept non-ASCII XID_Continue code points.
+namespace reference
+{
+
+  using Result = std::expected<Token, tks::Unknown>;
+  constant Err = std::unexpected<tks::Unknown>{tks::Unknown{}};
+
+  template<typename T>
+  inline auto number(const std::string& lexeme) -> Result
+    requires std::integral<T> or std::floating_point<T>
+  {
+    auto value = T{};
+    const auto [end, ec] = std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), value);
+
+    if (ec != std::errc{})
+    {
+      return tks::Error{tks::Fault::OutOfRange};
+    }
+
+    if constexpr (std::floating_point<T>)
+    {
+      return tks::FloatNum{constants::pool().intern(constants::Literal::real(value))};
+    }
+    else
+    {
+      return tks::IntNum{constants::pool().intern(constants::Literal::integer(value))};
+    }
+  }
+
+  // One identifier code point past ASCII at `index`, advancing past it.
+  inline auto xid_continue(const std::string& lexeme, std::size_t& index) -> bool
+  {
+    const auto code = utf8::decode(lexeme, index);
+    return code and utf8::is_xid_continue(*code);
+  }
+
+  inline Result symbol(std::string lexeme) 
+  {
+    constant symbols = 
+      std::array<std::pair<std::string_view, Token>, 16>
+      {
+        std::pair{"+"sv, tks::Plus{}},       // [X]
+        std::pair{"-"sv, tks::Minus{}},      // [X]
+        std::pair{"*"sv, tks::Mul{}},        // [X]
+        std::pair{"/"sv, tks::Devide{}},        // [X]
+        std::pair{"=="sv,tks::Equal{}},         // [X]
+        std::pair{"!="sv,tks::Unequal{}},       // [X]
+        std::pair{"<-"sv,tks::Assign{}},     // [X]
+        std::pair{":"sv, tks::Colon{}},      // [X]
+        std::pair{">="sv,tks::GrEqual{}},        // [X]
+        std::pair{"<="sv,tks::LeEqual{}},        // [X]
+        std::pair{"("sv, tks::ParanOpen{}}, // [X]
+        std::pair{")"sv, tks::ParanClose{}},// [X]
+        std::pair{"{"sv, tks::BraceOpen{}}, // [X]
+        std::pair{"}"sv, tks::BraceClose{}},// [X]
+        std::pair{">"sv, tks::Greater{}},         // [X]
+        std::pair{"<"sv, tks::Less{}},         // [X]
+      };
+
+    for (const auto& [sym_str, type] : symbols) 
+    {
+      if (sym_str == lexeme)
+      {
+        return type;
+      }
+    }
+
+    return Err;
+  }
+
+  inline Result identifier(std::string lexeme) 
+  {
+    constant alphabet = "_abcdefghijklmnopqrstuvwxyz"sv;
+
+    enum struct State { A, B, C };
+
+    auto is_in_alphabet = [](char ch) -> bool
+    {
+      if(alphabet.contains(ch))
+      {
+        return true;
+      }
+      return false;
+    };
+
+    auto state = State::A;
+    auto index = std::size_t{0};
+    while(true) 
+    {
+      switch(state)
+      {
+        case State::A: 
+          if (index < lexeme.size() and lexeme[index] == '_')
+          {
+            state = State::B;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::B: 
+          if(index >= lexeme.size())
+          {
+            // Numbered by reference_lex, in order of first occurrence.
+            return tks::Id{};
+          }
+          else 
+          {
+            if(is_in_alphabet(lexeme[index]))
+            {
+              state = State::B;
+              ++index;
+            }
+            else if(auto next = index; static_cast<unsigned char>(lexeme[index]) >= 0x80 and xid_continue(lexeme, next))
+            {
+              state = State::B;
+              index = next;
+            }
+            else 
+            {
+              state = State::C;
+            }
+          }
+          break;
+
+        case State::C: return Err;
+      }
+    }
+
+    std::unreachable();
+  }
+
+  inline Result if_kw(std::string lexeme) 
+  {
+    [[maybe_unused]] constant alphabet = "if"sv;
+    enum struct State { A, B, C, D };
+
+    auto state = State::A;
+    auto index = std::size_t{0};
+    while(true)
+    {
+      switch(state)
+      {
+        case State::A:
+          if (lexeme[index] == 'i')
+          {
+            state = State::B;
+            ++index;
+          }
+          else 
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::B:
+          if (lexeme[index] == 'f')
+          {
+            state = State::D;
+            ++index;
+          }
+          else 
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::C: return Err;
+          
+        case State::D:
+          if(index == lexeme.size())
+          {
+            return tks::If{};
+          }
+          else 
+          {
+            state = State::C;
+          }
+          break;
+      }
+    }
+    std::unreachable();
+  }
+
+  inline Result else_kw(std::string lexeme) 
+  {
+    [[maybe_unused]] constant alphabet = "else"sv;
+    enum struct State { A, B, C, D, E, F };
+
+    auto state = State::A;
+    auto index = std::size_t{0};
+    while(true)
+    {
+      switch(state)
+      {
+        case State::A:
+          if(lexeme[index] == 'e')
+          {
+            state = State::B;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::B:
+          if(lexeme[index] == 'l')
+          {
+            state = State::D;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::C: return Err;
+
+        case State::D:
+          if(lexeme[index] == 's')
+          {
+            state = State::E;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::E:
+          if(lexeme[index] == 'e')
+          {
+            state = State::F;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::F:
+          if(index == lexeme.size())
+          {
+            return tks::Else{};
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+      }
+    }
+    std::unreachable();
+  }
+
+
+  inline Result for_kw(std::string lexeme) 
+  {
+    [[maybe_unused]] constant alphabet = "for"sv;
+    enum struct State { A, B, C, D, E };
+
+    auto state = State::A;
+    auto index = std::size_t{0};
+
+    while(true)
+    {
+      switch(state) 
+      {
+        case State::A:
+          if (lexeme[index] == 'f')
+          {
+            state = State::B;
+            ++index;
+          }
+          else 
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::B:
+          if(lexeme[index] == 'o')
+          {
+            state = State::D;
+            ++index;
+          }
+          else 
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::C: return Err;
+
+        case State::D:
+          if(lexeme[index] == 'r')
+          {
+            state = State::E;
+            ++index;
+          }
+          else 
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::E:
+          if(index == lexeme.size())
+          {
+            return tks::For{};
+          }
+          else 
+          {
+            state = State::C;
+          }
+          break;
+      }
+    }
+    std::unreachable();
+  }
+
+  inline Result elif_kw(std::string lexeme) 
+  {
+    [[maybe_unused]] constant alphabet = "elif"sv;
+    enum struct State { A, B, C, D, E, F };
+
+    auto state = State::A;
+    auto index = std::size_t{0};
+
+    while(true)
+    {
+      switch(state) 
+      {
+        case State::A:
+          if(lexeme[index] == 'e')
+          {
+            state = State::B;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::B:
+          if(lexeme[index] == 'l')
+          {
+            state = State::D;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::C: return Err;
+
+        case State::D:
+          if(lexeme[index] == 'i')
+          {
+            state = State::E;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::E:
+          if(lexeme[index] == 'f')
+          {
+            state = State::F;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::F:
+          if(index == lexeme.size())
+          {
+            return tks::Elif{};
+          }
+          else 
+          {
+            state = State::C;
+          }
+          break;
+      }
+    }
+    std::unreachable();
+  }
+
+  inline Result proc_kw(std::string lexeme) 
+  {
+
+    [[maybe_unused]] constant alphabet = "proc"sv;
+    enum struct State { A, B, C, D, E, F };
+
+    auto state = State::A;
+    auto index = std::size_t{0};
+
+    while(true)
+    {
+      switch(state) 
+      {
+        case State::A:
+          if(lexeme[index] == 'p')
+          {
+            state = State::B;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::B:
+          if(lexeme[index] == 'r')
+          {
+            state = State::D;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::C: return Err;
+
+        case State::D:
+          if(lexeme[index] == 'o')
+          {
+            state = State::E;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::E:
+          if(lexeme[index] == 'c')
+          {
+            state = State::F;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::F:
+          if(index == lexeme.size())
+          {
+            return tks::Proc{};
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+      }
+    }
+    std::unreachable();
+  }
+
+  inline Result var_kw(std::string lexeme) 
+  {
+
+    [[maybe_unused]] constant alphabet = "proc"sv;
+    enum struct State { A, B, C, D, E };
+
+    auto state = State::A;
+    auto index = std::size_t{0};
+
+    while(true)
+    {
+      switch(state) 
+      {
+        case State::A:
+          if(lexeme[index] == 'v')
+          {
+            state = State::B;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::B:
+          if(lexeme[index] == 'a')
+          {
+            state = State::D;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::C: return Err;
+
+        case State::D:
+          if(lexeme[index] == 'r')
+          {
+            state = State::E;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::E:
+          if(index == lexeme.size())
+          {
+            return tks::Var{};
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+      }
+    }
+    std::unreachable();
+  }
+
+  inline Result run_kw(std::string lexeme) 
+  {
+
+    [[maybe_unused]] constant alphabet = "proc"sv;
+    enum struct State { A, B, C, D, E };
+
+    auto state = State::A;
+    auto index = std::size_t{0};
+
+    while(true)
+    {
+      switch(state) 
+      {
+        case State::A:
+          if(lexeme[index] == 'r')
+          {
+            state = State::B;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::B:
+          if(lexeme[index] == 'u')
+          {
+            state = State::D;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::C: return Err;
+
+        case State::D:
+          if(lexeme[index] == 'n')
+          {
+            state = State::E;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::E:
+          if(index == lexeme.size())
+          {
+            return tks::Run{};
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+      }
+    }
+    std::unreachable();
+  }
+
+  inline Result return_kw(std::string lexeme) 
+  {
+
+    [[maybe_unused]] constant alphabet = "proc"sv;
+    enum struct State { A, B, C, D, E, F, G, H };
+
+    auto state = State::A;
+    auto index = std::size_t{0};
+
+    while(true)
+    {
+      switch(state) 
+      {
+        case State::A:
+          if(lexeme[index] == 'r')
+          {
+            state = State::B;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::B:
+          if(lexeme[index] == 'e')
+          {
+            state = State::D;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::C: return Err;
+
+        case State::D:
+          if(lexeme[index] == 't')
+          {
+            state = State::E;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::E:
+          if(lexeme[index] == 'u')
+          {
+            state = State::F;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::F:
+          if(lexeme[index] == 'r')
+          {
+            state = State::G;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::G:
+          if(lexeme[index] == 'n')
+          {
+            state = State::H;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::H:
+          if(index == lexeme.size())
+          {
+            return tks::Return{};
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+        }
+    }
+    std::unreachable();
+  }
+
+  inline Result int_kw(std::string lexeme) 
+  {
+    [[maybe_unused]] constant alphabet = "int"sv;
+    enum struct State { A, B, C, D, E };
+
+    auto state = State::A;
+    auto index = std::size_t{0};
+
+    while(true)
+    {
+      switch(state) 
+      {
+        case State::A:
+          if(lexeme[index] == 'i')
+          {
+            state = State::B;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::B:
+          if(lexeme[index] == 'n')
+          {
+            state = State::D;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::C: return Err;
+
+        case State::D:
+          if(lexeme[index] == 't')
+          {
+            state = State::E;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::E:
+          if(index == lexeme.size())
+          {
+            return tks::Int{};
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+      }
+    }
+    std::unreachable();
+  }
+
+  inline Result float_kw(std::string lexeme) 
+  {
+
+    [[maybe_unused]] constant alphabet = "float"sv;
+    enum struct State { A, B, C, D, E, F, G };
+
+    auto state = State::A;
+    auto index = std::size_t{0};
+
+    while(true)
+    {
+      switch(state) 
+      {
+        case State::A:
+          if(lexeme[index] == 'f')
+          {
+            state = State::B;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::B:
+          if(lexeme[index] == 'l')
+          {
+            state = State::D;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::C: return Err;
+
+        case State::D:
+          if(lexeme[index] == 'o')
+          {
+            state = State::E;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::E:
+          if(lexeme[index] == 'a')
+          {
+            state = State::F;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::F:
+          if(lexeme[index] == 't')
+          {
+            state = State::G;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::G:
+          if(index == lexeme.size())
+          {
+            return tks::Float{};
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+      }
+    }
+    std::unreachable();
+  }
+
+  inline Result True_kw(std::string lexeme) 
+  {
+
+    [[maybe_unused]] constant alphabet = "True"sv;
+    enum struct State { A, B, C, D, E, F };
+
+    auto state = State::A;
+    auto index = std::size_t{0};
+
+    while(true)
+    {
+      switch(state) 
+      {
+        case State::A:
+          if(lexeme[index] == 'T')
+          {
+            state = State::B;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+        case State::B:
+          if(lexeme[index] == 'r')
+          {
+            state = State::D;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::C: return Err;
+
+        case State::D:
+          if(lexeme[index] == 'u')
+          {
+            state = State::E;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::E:
+          if(lexeme[index] == 'e')
+          {
+            state = State::F;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::F:
+          if(index == lexeme.size())
+          {
+            return tks::True{};
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+      }
+    }
+    std::unreachable();
+  }
+
+  inline Result False_kw(std::string lexeme) 
+  {
+
+    [[maybe_unused]] constant alphabet = "False"sv;
+    enum struct State { A, B, C, D, E, F, G };
+
+    auto state = State::A;
+    auto index = std::size_t{0};
+
+    while(true)
+    {
+      switch(state) 
+      {
+        case State::A:
+          if(lexeme[index] == 'F')
+          {
+            state = State::B;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+        case State::B:
+          if(lexeme[index] == 'a')
+          {
+            state = State::D;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::C: return Err;
+
+        case State::D:
+          if(lexeme[index] == 'l')
+          {
+            state = State::E;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::E:
+          if(lexeme[index] == 's')
+          {
+            state = State::F;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::F:
+          if(lexeme[index] == 'e')
+          {
+            state = State::G;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+        case State::G:
+          if(index == lexeme.size())
+          {
+            return tks::False{};
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+      }
+    }
+    std::unreachable();
+  }
+
+  inline Result bool_kw(std::string lexeme) 
+  {
+
+    [[maybe_unused]] constant alphabet = "bool"sv;
+    enum struct State { A, B, C, D, E, F };
+
+    auto state = State::A;
+    auto index = std::size_t{0};
+
+    while(true)
+    {
+      switch(state) 
+      {
+        case State::A:
+          if(lexeme[index] == 'b')
+          {
+            state = State::B;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+        case State::B:
+          if(lexeme[index] == 'o')
+          {
+            state = State::D;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::C: return Err;
+
+        case State::D:
+          if(lexeme[index] == 'o')
+          {
+            state = State::E;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::E:
+          if(lexeme[index] == 'l')
+          {
+            state = State::F;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::F:
+          if(index == lexeme.size())
+          {
+            return tks::Bool{};
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+      }
+    }
+    std::unreachable();
+  }
+
+  inline Result int_num_kw(std::string lexeme) 
+  {
+    [[maybe_unused]] constant alphabet = "0123456789"sv;
+    enum struct State { A, B, C, D };
+
+    auto state = State::A;
+    auto index = std::size_t{0};
+
+    while(true)
+    {
+      switch(state) 
+      {
+        case State::A:
+          if(index < lexeme.size() and alphabet.contains(lexeme[index]))
+          {
+            state = State::B;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::B:
+          if(index == lexeme.size())
+          {
+            return number<std::uint64_t>(lexeme);
+          }
+          else if(alphabet.contains(lexeme[index]))
+          {
+            state = State::D;
+            ++index;
+          }
+          else
+          {
+            state = State::C;
+          }
+          break;
+
+        case State::C: return Err;
+
+        case State::D:
+          if(index == lexeme.size())
+          {
+            return number<std::uint64_t>(lexeme);
+          }
+          else
+          {
+            if(alphabet.contains(lexeme[index]))
+            {
+              state = State::D;
+              ++index;
+            }
+            else
+            {
+              state = State::C;
+            }
+          }
+          break;
+      }
+    }
+    std::unreachable();
+  }
+
+  inline Result float_num_kw(std::string lexeme) 
+  {
+    [[maybe_unused]] constant alphabet = "0123456789."sv;
+    enum struct State { A, B, C, D, E, F };
+
+    auto is_in_alphabet = [](char ch) -> bool
+    {
+      if(alphabet.contains(ch))
+      {
+        return true;
+      }
+      return false;
+    };
+
+    auto state = State::A;
+    auto index = std::size_t{0};
+
+    while(true)
+    {
+      switch(state) 
+      {
+        case State::A:
+          if (index == lexeme.size())
+          {
+            state = State::F;
+          }
+          else if (is_in_alphabet(lexeme[index]) and std::isdigit(lexeme[index]))
+          {
+            state = State::B;
+            ++index;
+          }
+          else if (is_in_alphabet(lexeme[index]) and lexeme[index] == '.')
+          {
+            state = State::C;
+            ++index;
+          }
+          else 
+          {
+            state = State::F;
+          }
+          break;
+
+        case State::B:
+          if (index == lexeme.size())
+          {
+            state = State::F;
+          }
+          else if (is_in_alphabet(lexeme[index]) and std::isdigit(lexeme[index]))
+          {
+            state = State::B;
+            ++index;
+          }
+          else if (is_in_alphabet(lexeme[index]) and lexeme[index] == '.')
+          {
+            state = State::D;
+            ++index;
+          }
+          else
+          {
+            state = State::F;
+          }
+          break;
+
+        case State::C:
+          if (index == lexeme.size())
+          {
+            state = State::F;
+          }
+          else if (is_in_alphabet(lexeme[index]) and std::isdigit(lexeme[index]))
+          {
+            state = State::E;
+            ++index;
+          }
+          else if (is_in_alphabet(lexeme[index]) and lexeme[index] == '.')
+          {
+            state = State::F;
+          }
+          else
+          {
+            state = State::F;
+          }
+          break;
+
+        case State::D:
+          if(index == lexeme.size())
+          {
+            return number<double>(lexeme);
+          }
+          else 
+          {
+            if (is_in_alphabet(lexeme[index]) and std::isdigit(lexeme[index]))
+            {
+              state = State::D;
+              ++index;
+            }
+            else if (is_in_alphabet(lexeme[index]) and lexeme[index] == '.')
+            {
+              state = State::F;
+            }
+            else
+            {
+              state = State::F;
+            }
+          }
+          break;
+
+        case State::E:
+          if(index == lexeme.size())
+          {
+            return number<double>(lexeme);
+          }
+          else 
+          {
+            if (is_in_alphabet(lexeme[index]) and std::isdigit(lexeme[index]))
+            {
+              state = State::E;
+              ++index;
+            }
+            else if (is_in_alphabet(lexeme[index]) and lexeme[index] == '.')
+            {
+              state = State::F;
+            }
+            else
+            {
+              state = State::F;
+            }
+          }
+          break;
+
+        case State::F: return Err;
+      }
+    }
+    std::unreachable();
+  }
+
+  // Tried in order, the first match wins; keywords come before identifier.
+  constant recognizers =
+    std::array
+  {
+    symbol, 
+    if_kw,
+    else_kw,
+    for_kw,
+    elif_kw,
+    proc_kw,
+    var_kw,
+    run_kw,
+    return_kw,
+    int_kw,
+    float_kw,
+    True_kw,
+    False_kw,
+    bool_kw,
+    int_num_kw,
+    float_num_kw,
+    identifier
+  };
+
+}
@@ -0,0 +1,64 @@
+#include "oracle.hpp"
+
+#include "../include/suggest.hpp"
+
+#include <cstdint>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// suggest::Index::nearest against a linear edit-distance scan. The first
+// byte picks the tolerance, the rest is newline-separated: the query, then
+// the words, keyed from 1 in order. Bytes are folded onto a small alphabet
+// so words share prefixes and land within reach of each other.
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size)
+{
+  constexpr auto alphabet = std::string_view{"ab_c"};
+
+  if (size == 0)
+  {
+    return 0;
+  }
+
+  const auto tolerance = static_cast<std::int32_t>(data[0] % 4);
+
+  auto text = std::string(reinterpret_cast<const char*>(data + 1), size - 1);
+  for (auto& ch : text)
+  {
+    if (ch != '\n')
+    {
+      ch = alphabet[static_cast<unsigned char>(ch) % alphabet.size()];
+    }
+  }
+
+  const auto newline = text.find('\n');
+  const auto query   = std::string_view{text}.substr(0, newline);
+
+  auto words = std::vector<std::string_view>{};
+  if (newline != std::string::npos)
+  {
+    for (auto piece : std::string_view{text}.substr(newline + 1) | stdv::split('\n'))
+    {
+      words.emplace_back(piece.begin(), piece.end());
+    }
+  }
+
+  auto index = suggest::Index{};
+  for (auto key : range(0uz, words.size()))
+  {
+    index.insert(words[key], key + 1);
+  }
+
+  const auto expected = fuzz::nearest(words, query, tolerance);
+  const auto actual   = index.nearest(query, tolerance);
+
+  if (expected.has_value() != actual.has_value() or (expected and (expected->key != actual->key or expected->distance != actual->distance)))
+  {
+    std::println(stderr, "[Error] nearest \"{}\" within {}: expected key {} at {}, got key {} at {}", query, tolerance,
+        expected ? expected->key : 0, expected ? expected->distance : -1, actual ? actual->key : 0, actual ? actual->distance : -1);
+    std::abort();
+  }
+
+  return 0;
+}
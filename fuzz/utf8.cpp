@@ -0,0 +1,31 @@
+#include "oracle.hpp"
+
+#include "../include/utf8.hpp"
+
+#include <cstdint>
+#include <print>
+#include <string_view>
+
+// utf8::validate, with its vectorized ASCII skip, against a decode loop that
+// takes one code point at a time. The input is checked from every offset of
+// its first sixteen bytes, so each byte lands at each position in a block.
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size)
+{
+  const auto text = std::string_view{reinterpret_cast<const char*>(data), size};
+
+  for (auto offset : range(0uz, std::min<std::size_t>(size, 16) + 1))
+  {
+    const auto tail     = text.substr(offset);
+    const auto expected = fuzz::first_invalid(tail);
+    const auto actual   = utf8::validate(tail);
+
+    if (expected != actual)
+    {
+      std::println(stderr, "[Error] \"{}\" from offset {}: expected {}, got {}", utf8::escape(tail), offset,
+          expected ? static_cast<long long>(*expected) : -1, actual ? static_cast<long long>(*actual) : -1);
+      std::abort();
+    }
+  }
+
+  return 0;
+}
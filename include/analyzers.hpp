@@ -1,6 +1,10 @@
 #pragma once
 
 #include "tokens.hpp"
+#include "diagnostics.hpp"
+#include "suggest.hpp"
+#include "trace.hpp"
+#include "utf8.hpp"
 
 #include <expected>
 #include <string>
@@ -8,9 +12,16 @@
 #include <array>
 #include <ranges>
 #include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <memory_resource>
 #include <format>
+#include <generator>
 #include <unordered_map>
 #include <iostream>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -59,12 +70,19 @@ constant known_tokens =
       "bool"sv
     };
 
+// Scratch for one suggestion lookup lives on the stack; the heap is only
+// touched if a lexeme is long enough to outgrow it.
+constant scratch_bytes = 512uz;
+
 static std::int32_t levenshtein(std::string_view a, std::string_view b) {
     const auto m = a.size();
     const auto n = b.size();
 
-    auto dp   = std::vector<int>(n + 1);
-    auto prev = std::vector<int>(n + 1);
+    auto scratch = std::array<std::byte, scratch_bytes>{};
+    auto arena   = std::pmr::monotonic_buffer_resource{scratch.data(), scratch.size()};
+
+    auto dp   = std::pmr::vector<int>(n + 1, &arena);
+    auto prev = std::pmr::vector<int>(n + 1, &arena);
 
     for (auto j : range(0uz, n + 1))
     {
@@ -90,10 +108,18 @@ static std::int32_t levenshtein(std::string_view a, std::string_view b) {
 
 static std::string find_suggestion(std::string_view input) 
 {
-  auto scored = known_tokens
-                | stdv::transform([&input](auto const& tok) { return std::pair{ levenshtein(input, tok), tok }; })
-                | stdv::filter([](auto const& p) { return p.first <= 2; })
-                | stdr::to<std::vector>();
+  auto scratch = std::array<std::byte, scratch_bytes>{};
+  auto arena   = std::pmr::monotonic_buffer_resource{scratch.data(), scratch.size()};
+  auto scored  = std::pmr::vector<std::pair<std::int32_t, std::string_view>>{&arena};
+  scored.reserve(known_tokens.size());
+
+  for (auto tok : known_tokens)
+  {
+    if (auto distance = levenshtein(input, tok); distance <= 2)
+    {
+      scored.emplace_back(distance, tok);
+    }
+  }
 
   stdr::sort
   (
@@ -104,13 +130,9 @@ static std::string find_suggestion(std::string_view input)
       }
   );
 
-  auto result = scored
-                | stdv::transform([](const auto& pair){ return pair.second; })
-                | stdr::to<std::vector>();
-
-  if(not result.empty())
+  if(not scored.empty())
   {
-    return std::string{result.at(0)};
+    return std::string{scored.front().second};
   }
 
   return {};
@@ -122,8 +144,25 @@ namespace analyzer
   namespace detail 
   {
 
+    // Recognizers see views into the source, which have no terminator to read.
+    constexpr auto peek(std::string_view lexeme, std::size_t index) -> char
+    {
+      return index < lexeme.size() ? lexeme[index] : '\0';
+    }
+
+    struct string_hash
+    {
+      using is_transparent = void;
+
+      auto operator()(std::string_view s) const -> std::size_t
+      {
+        return std::hash<std::string_view>{}(s);
+      }
+    };
+
+    // Slow path for literals the fast paths below cannot convert exactly.
     template<typename T>
-    constexpr auto parse_number(std::string_view expr) -> T
+    constexpr auto parse_number(std::string_view expr) -> std::optional<T>
       requires std::integral<T> or std::floating_point<T>
     {
       auto res = T{};
@@ -134,25 +173,263 @@ namespace analyzer
           res
       );
 
-      switch (ec)
+      if (ec != std::errc{})
       {
-        case std::errc::invalid_argument   : res = 0; break;
-        case std::errc::result_out_of_range: res = std::numeric_limits<std::uint64_t>::max(); break;
-        default: break;
+        return std::nullopt;
       }
 
       return res;
     }
 
+    // Value of the digit run a recognizer walks over, built while it scans.
+    struct Digits
+    {
+      std::uint64_t value    = 0;
+      bool          overflow = false;
+
+      constexpr void push(std::uint64_t digits, std::uint64_t scale)
+      {
+        if (value > (std::numeric_limits<std::uint64_t>::max() - digits) / scale)
+        {
+          overflow = true;
+          return;
+        }
+        value = value * scale + digits;
+      }
+    };
+
+    constexpr auto is_digit(char ch) -> bool
+    {
+      return ch >= '0' and ch <= '9';
+    }
+
+    // Eight bytes as a little-endian word, first character in the low byte.
+    constexpr auto load8(std::string_view s, std::size_t index) -> std::uint64_t
+    {
+      auto chunk = std::uint64_t{0};
+
+      if consteval
+      {
+        for (auto k : range(0uz, 8uz))
+        {
+          chunk |= std::uint64_t{static_cast<unsigned char>(s[index + k])} << (8 * k);
+        }
+      }
+      else
+      {
+        std::memcpy(&chunk, s.data() + index, sizeof(chunk));
+        if constexpr (std::endian::native == std::endian::big)
+        {
+          chunk = std::byteswap(chunk);
+        }
+      }
+
+      return chunk;
+    }
+
+    // SWAR check that all eight bytes are '0'..'9'.
+    constexpr auto eight_digits(std::uint64_t chunk) -> bool
+    {
+      return ((chunk & 0xF0F0F0F0F0F0F0F0) | (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333;
+    }
+
+    // SWAR conversion of eight ASCII digits in three multiply steps.
+    constexpr auto parse_eight_digits(std::uint64_t chunk) -> std::uint64_t
+    {
+      chunk -= 0x3030303030303030;
+      chunk  = (chunk * 10) + (chunk >> 8);
+      chunk  = (((chunk & 0x000000FF000000FF) * (100 + (1000000ULL << 32)))
+             + (((chunk >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >> 32;
+      return chunk;
+    }
+
+    // Consumes the digit run at `index`, eight at a time while it lasts, and
+    // returns how many digits were read.
+    constexpr auto scan_digits(std::string_view lexeme, std::size_t& index, Digits& digits) -> std::size_t
+    {
+      const auto start = index;
+
+      while (lexeme.size() - index >= 8)
+      {
+        const auto chunk = load8(lexeme, index);
+        if (not eight_digits(chunk))
+        {
+          break;
+        }
+        digits.push(parse_eight_digits(chunk), 100'000'000);
+        index += 8;
+      }
+
+      while (index < lexeme.size() and is_digit(lexeme[index]))
+      {
+        digits.push(static_cast<std::uint64_t>(lexeme[index] - '0'), 10);
+        ++index;
+      }
+
+      return index - start;
+    }
+
+    // Clinger's fast path: a mantissa of at most 53 bits divided by an exact
+    // power of ten is correctly rounded, anything else goes to from_chars,
+    // which is why such literals cannot be lexed at build time.
+    constexpr auto make_double(std::string_view literal, const Digits& mantissa, std::size_t fraction) -> std::optional<double>
+    {
+      constant powers = std::array
+      {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+      };
+
+      if (not mantissa.overflow and mantissa.value <= (1ULL << 53) and fraction < powers.size())
+      {
+        return static_cast<double>(mantissa.value) / powers[fraction];
+      }
+
+      return parse_number<double>(literal);
+    }
+
   }
 
-  using Result = std::expected<Token, tks::Unknown>;
+  // A recognizer matches a prefix of the lexeme and reports how long it is;
+  // the caller decides whether a partial match is good enough.
+  struct Match
+  {
+    Token              token;
+    std::size_t        length;
+    constants::Literal literal = {}; // value of an IntNum or FloatNum, not yet pooled
+  };
+
+  using Result = std::expected<Match, tks::Unknown>;
   constant Err = std::unexpected<tks::Unknown>{tks::Unknown{}};
 
-  static auto identifier_table = std::unordered_map<std::string, std::size_t>{};
-  static auto identifier_id    = std::size_t{0};
+  // Symbol numbers by name, plus names by symbol - 1 and the suggestion
+  // index over them. The index only catches up when a suggestion is asked
+  // for, so clean input never pays for it. Names point into the table's
+  // nodes, so a table never moves.
+  struct Identifiers
+  {
+    explicit Identifiers(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : table{resource}
+      , names{resource}
+      , index{resource}
+    {
+    }
+
+    Identifiers(const Identifiers&)            = delete;
+    Identifiers& operator=(const Identifiers&) = delete;
+
+    // Clearing keeps the buckets, so a warm table does not rehash from scratch.
+    void clear()
+    {
+      table.clear();
+      names.clear();
+      index.clear();
+      id = 0;
+    }
+
+    std::pmr::unordered_map<std::pmr::string, std::size_t, detail::string_hash, std::equal_to<>> table;
+    std::pmr::vector<std::string_view>                                                          names;
+    suggest::Index                                                                              index;
+    std::size_t                                                                                 id = 0;
+  };
+
+  // One table per thread, so concurrent compilations (the server) never share
+  // symbol numbers; a thread starts every compilation with reset_identifiers().
+  // A caller that keeps its own table across compilations (an LSP document)
+  // lends it to the thread with an IdentifierScope instead.
+  namespace detail
+  {
+
+    // Interner nodes come from a pool owned by their thread, so concurrent
+    // compilations never contend on the global allocator for them.
+    inline auto identifier_pool() -> std::pmr::unsynchronized_pool_resource&
+    {
+      thread_local auto pool = std::pmr::unsynchronized_pool_resource{};
+      return pool;
+    }
 
-  constexpr Result symbol(std::string lexeme) 
+    inline auto thread_identifiers() -> Identifiers&
+    {
+      thread_local auto table = Identifiers{&identifier_pool()};
+      return table;
+    }
+
+    inline thread_local Identifiers* lent_identifiers = nullptr;
+
+  }
+
+  [[nodiscard]]
+  inline auto identifiers() -> Identifiers&
+  {
+    return detail::lent_identifiers != nullptr ? *detail::lent_identifiers : detail::thread_identifiers();
+  }
+
+  // Makes `table` the calling thread's identifier table until it goes out of scope.
+  class IdentifierScope
+  {
+  public:
+    explicit IdentifierScope(Identifiers& table)
+      : previous_{std::exchange(detail::lent_identifiers, &table)}
+    {
+    }
+
+    IdentifierScope(const IdentifierScope&)            = delete;
+    IdentifierScope& operator=(const IdentifierScope&) = delete;
+
+    ~IdentifierScope()
+    {
+      detail::lent_identifiers = previous_;
+    }
+
+  private:
+    Identifiers* previous_;
+  };
+
+  inline void reset_identifiers()
+  {
+    identifiers().clear();
+  }
+
+  // Identifiers are interned only once a whole lexeme is accepted, so the
+  // recognizers themselves stay free of side effects.
+  inline std::size_t intern(std::string_view name)
+  {
+    auto& identifiers = analyzer::identifiers();
+
+    if (auto it = identifiers.table.find(name); it != identifiers.table.end())
+    {
+      return it->second;
+    }
+
+    const auto& [key, symbol] = *identifiers.table.emplace(name, ++identifiers.id).first;
+    identifiers.names.push_back(key);
+    return symbol;
+  }
+
+  // What an unknown lexeme was probably meant to be: the closest keyword or
+  // symbol, unless an identifier seen so far is strictly closer. Both within
+  // an edit distance of 2; empty when nothing is that close.
+  inline std::string suggest(std::string_view lexeme)
+  {
+    auto scope = trace::Scope{"suggest"};
+
+    auto& identifiers = analyzer::identifiers();
+    for (auto symbol = identifiers.index.size(); symbol < identifiers.names.size(); ++symbol)
+    {
+      identifiers.index.insert(identifiers.names[symbol], symbol + 1);
+    }
+
+    auto keyword   = find_suggestion(lexeme);
+    auto tolerance = keyword.empty() ? 2 : levenshtein(lexeme, keyword) - 1;
+
+    if (auto identifier = identifiers.index.nearest(lexeme, tolerance))
+    {
+      return std::string{identifiers.names[identifier->key - 1]};
+    }
+    return keyword;
+  }
+
+  constexpr Result symbol(std::string_view lexeme) 
   {
     constant symbols = 
       std::array<std::pair<std::string_view, Token>, 16>
@@ -175,18 +452,19 @@ namespace analyzer
         std::pair{"<"sv, tks::Less{}},         // [X]
       };
 
+    // Two-character symbols are listed before their one-character prefixes.
     for (const auto& [sym_str, type] : symbols) 
     {
-      if (sym_str == lexeme)
+      if (lexeme.starts_with(sym_str))
       {
-        return type;
+        return Match{.token = type, .length = sym_str.size()};
       }
     }
 
     return Err;
   }
 
-  constexpr Result identifier(std::string lexeme) 
+  constexpr Result identifier(std::string_view lexeme) 
   {
     constant alphabet = "_abcdefghijklmnopqrstuvwxyz"sv;
 
@@ -208,7 +486,7 @@ namespace analyzer
       switch(state)
       {
         case State::A: 
-          if (lexeme[index] == '_')
+          if (index < lexeme.size() and lexeme[index] == '_')
           {
             state = State::B;
             ++index;
@@ -220,31 +498,24 @@ namespace analyzer
           break;
 
         case State::B: 
-          if(index >= lexeme.size())
+          if(index < lexeme.size() and is_in_alphabet(lexeme[index]))
           {
-            if(identifier_table.contains(lexeme))
-            {
-              // If Identifier exists in Identifier table
-              return tks::Id{identifier_table[lexeme]};
-            }
-            else
+            state = State::B;
+            ++index;
+          }
+          else if(index < lexeme.size() and static_cast<unsigned char>(lexeme[index]) >= 0x80)
+          {
+            // Past ASCII, any code point Unicode allows inside an identifier.
+            auto next = index;
+            if (auto code = utf8::decode(lexeme, next); not code or not utf8::is_xid_continue(*code))
             {
-              // If Identifier does not exist in Identifier table
-              identifier_table[lexeme] = ++identifier_id;
-              return tks::Id{identifier_table[lexeme]};
+              return Match{.token = tks::Id{}, .length = index};
             }
+            index = next;
           }
           else 
           {
-            if(is_in_alphabet(lexeme[index]))
-            {
-              state = State::B;
-              ++index;
-            }
-            else 
-            {
-              state = State::C;
-            }
+            return Match{.token = tks::Id{}, .length = index};
           }
           break;
 
@@ -255,7 +526,7 @@ namespace analyzer
     std::unreachable();
   }
 
-  constexpr Result if_kw(std::string lexeme) 
+  constexpr Result if_kw(std::string_view lexeme) 
   {
     [[maybe_unused]] constant alphabet = "if"sv;
     enum struct State { A, B, C, D };
@@ -267,7 +538,7 @@ namespace analyzer
       switch(state)
       {
         case State::A:
-          if (lexeme[index] == 'i')
+          if (detail::peek(lexeme, index) == 'i')
           {
             state = State::B;
             ++index;
@@ -279,7 +550,7 @@ namespace analyzer
           break;
 
         case State::B:
-          if (lexeme[index] == 'f')
+          if (detail::peek(lexeme, index) == 'f')
           {
             state = State::D;
             ++index;
@@ -293,21 +564,13 @@ namespace analyzer
         case State::C: return Err;
           
         case State::D:
-          if(index == lexeme.size())
-          {
-            return tks::If{};
-          }
-          else 
-          {
-            state = State::C;
-          }
-          break;
+          return Match{.token = tks::If{}, .length = index};
       }
     }
     std::unreachable();
   }
 
-  constexpr Result else_kw(std::string lexeme) 
+  constexpr Result else_kw(std::string_view lexeme) 
   {
     [[maybe_unused]] constant alphabet = "else"sv;
     enum struct State { A, B, C, D, E, F };
@@ -319,7 +582,7 @@ namespace analyzer
       switch(state)
       {
         case State::A:
-          if(lexeme[index] == 'e')
+          if(detail::peek(lexeme, index) == 'e')
           {
             state = State::B;
             ++index;
@@ -331,7 +594,7 @@ namespace analyzer
           break;
 
         case State::B:
-          if(lexeme[index] == 'l')
+          if(detail::peek(lexeme, index) == 'l')
           {
             state = State::D;
             ++index;
@@ -345,7 +608,7 @@ namespace analyzer
         case State::C: return Err;
 
         case State::D:
-          if(lexeme[index] == 's')
+          if(detail::peek(lexeme, index) == 's')
           {
             state = State::E;
             ++index;
@@ -357,7 +620,7 @@ namespace analyzer
           break;
 
         case State::E:
-          if(lexeme[index] == 'e')
+          if(detail::peek(lexeme, index) == 'e')
           {
             state = State::F;
             ++index;
@@ -369,22 +632,14 @@ namespace analyzer
           break;
 
         case State::F:
-          if(index == lexeme.size())
-          {
-            return tks::Else{};
-          }
-          else
-          {
-            state = State::C;
-          }
-          break;
+          return Match{.token = tks::Else{}, .length = index};
       }
     }
     std::unreachable();
   }
 
 
-  constexpr Result for_kw(std::string lexeme) 
+  constexpr Result for_kw(std::string_view lexeme) 
   {
     [[maybe_unused]] constant alphabet = "for"sv;
     enum struct State { A, B, C, D, E };
@@ -397,7 +652,7 @@ namespace analyzer
       switch(state) 
       {
         case State::A:
-          if (lexeme[index] == 'f')
+          if (detail::peek(lexeme, index) == 'f')
           {
             state = State::B;
             ++index;
@@ -409,7 +664,7 @@ namespace analyzer
           break;
 
         case State::B:
-          if(lexeme[index] == 'o')
+          if(detail::peek(lexeme, index) == 'o')
           {
             state = State::D;
             ++index;
@@ -423,7 +678,7 @@ namespace analyzer
         case State::C: return Err;
 
         case State::D:
-          if(lexeme[index] == 'r')
+          if(detail::peek(lexeme, index) == 'r')
           {
             state = State::E;
             ++index;
@@ -435,21 +690,13 @@ namespace analyzer
           break;
 
         case State::E:
-          if(index == lexeme.size())
-          {
-            return tks::For{};
-          }
-          else 
-          {
-            state = State::C;
-          }
-          break;
+          return Match{.token = tks::For{}, .length = index};
       }
     }
     std::unreachable();
   }
 
-  constexpr Result elif_kw(std::string lexeme) 
+  constexpr Result elif_kw(std::string_view lexeme) 
   {
     [[maybe_unused]] constant alphabet = "elif"sv;
     enum struct State { A, B, C, D, E, F };
@@ -462,7 +709,7 @@ namespace analyzer
       switch(state) 
       {
         case State::A:
-          if(lexeme[index] == 'e')
+          if(detail::peek(lexeme, index) == 'e')
           {
             state = State::B;
             ++index;
@@ -474,7 +721,7 @@ namespace analyzer
           break;
 
         case State::B:
-          if(lexeme[index] == 'l')
+          if(detail::peek(lexeme, index) == 'l')
           {
             state = State::D;
             ++index;
@@ -488,7 +735,7 @@ namespace analyzer
         case State::C: return Err;
 
         case State::D:
-          if(lexeme[index] == 'i')
+          if(detail::peek(lexeme, index) == 'i')
           {
             state = State::E;
             ++index;
@@ -500,7 +747,7 @@ namespace analyzer
           break;
 
         case State::E:
-          if(lexeme[index] == 'f')
+          if(detail::peek(lexeme, index) == 'f')
           {
             state = State::F;
             ++index;
@@ -512,21 +759,13 @@ namespace analyzer
           break;
 
         case State::F:
-          if(index == lexeme.size())
-          {
-            return tks::Elif{};
-          }
-          else 
-          {
-            state = State::C;
-          }
-          break;
+          return Match{.token = tks::Elif{}, .length = index};
       }
     }
     std::unreachable();
   }
 
-  constexpr Result proc_kw(std::string lexeme) 
+  constexpr Result proc_kw(std::string_view lexeme) 
   {
 
     [[maybe_unused]] constant alphabet = "proc"sv;
@@ -540,7 +779,7 @@ namespace analyzer
       switch(state) 
       {
         case State::A:
-          if(lexeme[index] == 'p')
+          if(detail::peek(lexeme, index) == 'p')
           {
             state = State::B;
             ++index;
@@ -552,7 +791,7 @@ namespace analyzer
           break;
 
         case State::B:
-          if(lexeme[index] == 'r')
+          if(detail::peek(lexeme, index) == 'r')
           {
             state = State::D;
             ++index;
@@ -566,7 +805,7 @@ namespace analyzer
         case State::C: return Err;
 
         case State::D:
-          if(lexeme[index] == 'o')
+          if(detail::peek(lexeme, index) == 'o')
           {
             state = State::E;
             ++index;
@@ -578,7 +817,7 @@ namespace analyzer
           break;
 
         case State::E:
-          if(lexeme[index] == 'c')
+          if(detail::peek(lexeme, index) == 'c')
           {
             state = State::F;
             ++index;
@@ -590,21 +829,13 @@ namespace analyzer
           break;
 
         case State::F:
-          if(index == lexeme.size())
-          {
-            return tks::Proc{};
-          }
-          else
-          {
-            state = State::C;
-          }
-          break;
+          return Match{.token = tks::Proc{}, .length = index};
       }
     }
     std::unreachable();
   }
 
-  constexpr Result var_kw(std::string lexeme) 
+  constexpr Result var_kw(std::string_view lexeme) 
   {
 
     [[maybe_unused]] constant alphabet = "proc"sv;
@@ -618,7 +849,7 @@ namespace analyzer
       switch(state) 
       {
         case State::A:
-          if(lexeme[index] == 'v')
+          if(detail::peek(lexeme, index) == 'v')
           {
             state = State::B;
             ++index;
@@ -630,7 +861,7 @@ namespace analyzer
           break;
 
         case State::B:
-          if(lexeme[index] == 'a')
+          if(detail::peek(lexeme, index) == 'a')
           {
             state = State::D;
             ++index;
@@ -644,7 +875,7 @@ namespace analyzer
         case State::C: return Err;
 
         case State::D:
-          if(lexeme[index] == 'r')
+          if(detail::peek(lexeme, index) == 'r')
           {
             state = State::E;
             ++index;
@@ -656,21 +887,13 @@ namespace analyzer
           break;
 
         case State::E:
-          if(index == lexeme.size())
-          {
-            return tks::Var{};
-          }
-          else
-          {
-            state = State::C;
-          }
-          break;
+          return Match{.token = tks::Var{}, .length = index};
       }
     }
     std::unreachable();
   }
 
-  constexpr Result run_kw(std::string lexeme) 
+  constexpr Result run_kw(std::string_view lexeme) 
   {
 
     [[maybe_unused]] constant alphabet = "proc"sv;
@@ -684,7 +907,7 @@ namespace analyzer
       switch(state) 
       {
         case State::A:
-          if(lexeme[index] == 'r')
+          if(detail::peek(lexeme, index) == 'r')
           {
             state = State::B;
             ++index;
@@ -696,7 +919,7 @@ namespace analyzer
           break;
 
         case State::B:
-          if(lexeme[index] == 'u')
+          if(detail::peek(lexeme, index) == 'u')
           {
             state = State::D;
             ++index;
@@ -710,7 +933,7 @@ namespace analyzer
         case State::C: return Err;
 
         case State::D:
-          if(lexeme[index] == 'n')
+          if(detail::peek(lexeme, index) == 'n')
           {
             state = State::E;
             ++index;
@@ -722,21 +945,13 @@ namespace analyzer
           break;
 
         case State::E:
-          if(index == lexeme.size())
-          {
-            return tks::Run{};
-          }
-          else
-          {
-            state = State::C;
-          }
-          break;
+          return Match{.token = tks::Run{}, .length = index};
       }
     }
     std::unreachable();
   }
 
-  constexpr Result return_kw(std::string lexeme) 
+  constexpr Result return_kw(std::string_view lexeme) 
   {
 
     [[maybe_unused]] constant alphabet = "proc"sv;
@@ -750,7 +965,7 @@ namespace analyzer
       switch(state) 
       {
         case State::A:
-          if(lexeme[index] == 'r')
+          if(detail::peek(lexeme, index) == 'r')
           {
             state = State::B;
             ++index;
@@ -762,7 +977,7 @@ namespace analyzer
           break;
 
         case State::B:
-          if(lexeme[index] == 'e')
+          if(detail::peek(lexeme, index) == 'e')
           {
             state = State::D;
             ++index;
@@ -776,7 +991,7 @@ namespace analyzer
         case State::C: return Err;
 
         case State::D:
-          if(lexeme[index] == 't')
+          if(detail::peek(lexeme, index) == 't')
           {
             state = State::E;
             ++index;
@@ -788,7 +1003,7 @@ namespace analyzer
           break;
 
         case State::E:
-          if(lexeme[index] == 'u')
+          if(detail::peek(lexeme, index) == 'u')
           {
             state = State::F;
             ++index;
@@ -800,7 +1015,7 @@ namespace analyzer
           break;
 
         case State::F:
-          if(lexeme[index] == 'r')
+          if(detail::peek(lexeme, index) == 'r')
           {
             state = State::G;
             ++index;
@@ -812,7 +1027,7 @@ namespace analyzer
           break;
 
         case State::G:
-          if(lexeme[index] == 'n')
+          if(detail::peek(lexeme, index) == 'n')
           {
             state = State::H;
             ++index;
@@ -824,21 +1039,13 @@ namespace analyzer
           break;
 
         case State::H:
-          if(index == lexeme.size())
-          {
-            return tks::Return{};
-          }
-          else
-          {
-            state = State::C;
-          }
-          break;
+          return Match{.token = tks::Return{}, .length = index};
         }
     }
     std::unreachable();
   }
 
-  constexpr Result int_kw(std::string lexeme) 
+  constexpr Result int_kw(std::string_view lexeme) 
   {
     [[maybe_unused]] constant alphabet = "int"sv;
     enum struct State { A, B, C, D, E };
@@ -851,7 +1058,7 @@ namespace analyzer
       switch(state) 
       {
         case State::A:
-          if(lexeme[index] == 'i')
+          if(detail::peek(lexeme, index) == 'i')
           {
             state = State::B;
             ++index;
@@ -863,7 +1070,7 @@ namespace analyzer
           break;
 
         case State::B:
-          if(lexeme[index] == 'n')
+          if(detail::peek(lexeme, index) == 'n')
           {
             state = State::D;
             ++index;
@@ -877,7 +1084,7 @@ namespace analyzer
         case State::C: return Err;
 
         case State::D:
-          if(lexeme[index] == 't')
+          if(detail::peek(lexeme, index) == 't')
           {
             state = State::E;
             ++index;
@@ -889,21 +1096,13 @@ namespace analyzer
           break;
 
         case State::E:
-          if(index == lexeme.size())
-          {
-            return tks::Int{};
-          }
-          else
-          {
-            state = State::C;
-          }
-          break;
+          return Match{.token = tks::Int{}, .length = index};
       }
     }
     std::unreachable();
   }
 
-  constexpr Result float_kw(std::string lexeme) 
+  constexpr Result float_kw(std::string_view lexeme) 
   {
 
     [[maybe_unused]] constant alphabet = "float"sv;
@@ -917,7 +1116,7 @@ namespace analyzer
       switch(state) 
       {
         case State::A:
-          if(lexeme[index] == 'f')
+          if(detail::peek(lexeme, index) == 'f')
           {
             state = State::B;
             ++index;
@@ -929,7 +1128,7 @@ namespace analyzer
           break;
 
         case State::B:
-          if(lexeme[index] == 'l')
+          if(detail::peek(lexeme, index) == 'l')
           {
             state = State::D;
             ++index;
@@ -943,7 +1142,7 @@ namespace analyzer
         case State::C: return Err;
 
         case State::D:
-          if(lexeme[index] == 'o')
+          if(detail::peek(lexeme, index) == 'o')
           {
             state = State::E;
             ++index;
@@ -955,7 +1154,7 @@ namespace analyzer
           break;
 
         case State::E:
-          if(lexeme[index] == 'a')
+          if(detail::peek(lexeme, index) == 'a')
           {
             state = State::F;
             ++index;
@@ -967,7 +1166,7 @@ namespace analyzer
           break;
 
         case State::F:
-          if(lexeme[index] == 't')
+          if(detail::peek(lexeme, index) == 't')
           {
             state = State::G;
             ++index;
@@ -979,21 +1178,13 @@ namespace analyzer
           break;
 
         case State::G:
-          if(index == lexeme.size())
-          {
-            return tks::Float{};
-          }
-          else
-          {
-            state = State::C;
-          }
-          break;
+          return Match{.token = tks::Float{}, .length = index};
       }
     }
     std::unreachable();
   }
 
-  constexpr Result True_kw(std::string lexeme) 
+  constexpr Result True_kw(std::string_view lexeme) 
   {
 
     [[maybe_unused]] constant alphabet = "True"sv;
@@ -1007,7 +1198,7 @@ namespace analyzer
       switch(state) 
       {
         case State::A:
-          if(lexeme[index] == 'T')
+          if(detail::peek(lexeme, index) == 'T')
           {
             state = State::B;
             ++index;
@@ -1018,7 +1209,7 @@ namespace analyzer
           }
           break;
         case State::B:
-          if(lexeme[index] == 'r')
+          if(detail::peek(lexeme, index) == 'r')
           {
             state = State::D;
             ++index;
@@ -1032,7 +1223,7 @@ namespace analyzer
         case State::C: return Err;
 
         case State::D:
-          if(lexeme[index] == 'u')
+          if(detail::peek(lexeme, index) == 'u')
           {
             state = State::E;
             ++index;
@@ -1044,7 +1235,7 @@ namespace analyzer
           break;
 
         case State::E:
-          if(lexeme[index] == 'e')
+          if(detail::peek(lexeme, index) == 'e')
           {
             state = State::F;
             ++index;
@@ -1056,21 +1247,13 @@ namespace analyzer
           break;
 
         case State::F:
-          if(index == lexeme.size())
-          {
-            return tks::True{};
-          }
-          else
-          {
-            state = State::C;
-          }
-          break;
+          return Match{.token = tks::True{}, .length = index};
       }
     }
     std::unreachable();
   }
 
-  constexpr Result False_kw(std::string lexeme) 
+  constexpr Result False_kw(std::string_view lexeme) 
   {
 
     [[maybe_unused]] constant alphabet = "False"sv;
@@ -1084,7 +1267,7 @@ namespace analyzer
       switch(state) 
       {
         case State::A:
-          if(lexeme[index] == 'F')
+          if(detail::peek(lexeme, index) == 'F')
           {
             state = State::B;
             ++index;
@@ -1095,7 +1278,7 @@ namespace analyzer
           }
           break;
         case State::B:
-          if(lexeme[index] == 'a')
+          if(detail::peek(lexeme, index) == 'a')
           {
             state = State::D;
             ++index;
@@ -1109,7 +1292,7 @@ namespace analyzer
         case State::C: return Err;
 
         case State::D:
-          if(lexeme[index] == 'l')
+          if(detail::peek(lexeme, index) == 'l')
           {
             state = State::E;
             ++index;
@@ -1121,7 +1304,7 @@ namespace analyzer
           break;
 
         case State::E:
-          if(lexeme[index] == 's')
+          if(detail::peek(lexeme, index) == 's')
           {
             state = State::F;
             ++index;
@@ -1133,7 +1316,7 @@ namespace analyzer
           break;
 
         case State::F:
-          if(lexeme[index] == 'e')
+          if(detail::peek(lexeme, index) == 'e')
           {
             state = State::G;
             ++index;
@@ -1144,21 +1327,13 @@ namespace analyzer
           }
           break;
         case State::G:
-          if(index == lexeme.size())
-          {
-            return tks::False{};
-          }
-          else
-          {
-            state = State::C;
-          }
-          break;
+          return Match{.token = tks::False{}, .length = index};
       }
     }
     std::unreachable();
   }
 
-  constexpr Result bool_kw(std::string lexeme) 
+  constexpr Result bool_kw(std::string_view lexeme) 
   {
 
     [[maybe_unused]] constant alphabet = "bool"sv;
@@ -1172,7 +1347,7 @@ namespace analyzer
       switch(state) 
       {
         case State::A:
-          if(lexeme[index] == 'b')
+          if(detail::peek(lexeme, index) == 'b')
           {
             state = State::B;
             ++index;
@@ -1183,7 +1358,7 @@ namespace analyzer
           }
           break;
         case State::B:
-          if(lexeme[index] == 'o')
+          if(detail::peek(lexeme, index) == 'o')
           {
             state = State::D;
             ++index;
@@ -1197,7 +1372,7 @@ namespace analyzer
         case State::C: return Err;
 
         case State::D:
-          if(lexeme[index] == 'o')
+          if(detail::peek(lexeme, index) == 'o')
           {
             state = State::E;
             ++index;
@@ -1209,7 +1384,7 @@ namespace analyzer
           break;
 
         case State::E:
-          if(lexeme[index] == 'l')
+          if(detail::peek(lexeme, index) == 'l')
           {
             state = State::F;
             ++index;
@@ -1221,37 +1396,29 @@ namespace analyzer
           break;
 
         case State::F:
-          if(index == lexeme.size())
-          {
-            return tks::Bool{};
-          }
-          else
-          {
-            state = State::C;
-          }
-          break;
+          return Match{.token = tks::Bool{}, .length = index};
       }
     }
     std::unreachable();
   }
 
-  constexpr Result int_num_kw(std::string lexeme) 
+  constexpr Result int_num_kw(std::string_view lexeme) 
   {
-    [[maybe_unused]] constant alphabet = "0123456789"sv;
-    enum struct State { A, B, C, D };
+    enum struct State { A, B, C };
 
-    auto state = State::A;
-    auto index = std::size_t{0};
+    auto state  = State::A;
+    auto index  = std::size_t{0};
+    auto digits = detail::Digits{};
 
     while(true)
     {
       switch(state) 
       {
         case State::A:
-          if(alphabet.contains(lexeme[index]))
+          if(index < lexeme.size() and detail::is_digit(lexeme[index]))
           {
+            detail::scan_digits(lexeme, index, digits);
             state = State::B;
-            ++index;
           }
           else
           {
@@ -1260,74 +1427,47 @@ namespace analyzer
           break;
 
         case State::B:
-          if(index == lexeme.size())
-          {
-            return tks::IntNum{.value = detail::parse_number<std::uint64_t>(lexeme)};
-          }
-          else if(alphabet.contains(lexeme[index]))
-          {
-            state = State::D;
-            ++index;
-          }
-          else
+          if(digits.overflow)
           {
-            state = State::C;
+            return Match{.token = tks::Error{tks::Fault::OutOfRange}, .length = index};
           }
-          break;
+          return Match{.token = tks::IntNum{}, .length = index, .literal = constants::Literal::integer(digits.value)};
 
         case State::C: return Err;
-
-        case State::D:
-          if(index == lexeme.size())
-          {
-            return tks::IntNum{.value = detail::parse_number<std::uint64_t>(lexeme)};
-          }
-          else
-          {
-            if(alphabet.contains(lexeme[index]))
-            {
-              state = State::D;
-              ++index;
-            }
-            else
-            {
-              state = State::C;
-            }
-          }
-          break;
       }
     }
     std::unreachable();
   }
 
-  constexpr Result float_num_kw(std::string lexeme) 
+  constexpr Result float_num_kw(std::string_view lexeme) 
   {
-    [[maybe_unused]] constant alphabet = "0123456789."sv;
     enum struct State { A, B, C, D, E, F };
 
-    auto is_in_alphabet = [](char ch) -> bool
+    auto state    = State::A;
+    auto index    = std::size_t{0};
+    auto mantissa = detail::Digits{};
+    auto fraction = std::size_t{0};
+
+    auto accept = [&]() -> Result
     {
-      if(alphabet.contains(ch))
+      if (auto value = detail::make_double(lexeme.substr(0, index), mantissa, fraction))
       {
-        return true;
+        return Match{.token = tks::FloatNum{}, .length = index, .literal = constants::Literal::real(*value)};
       }
-      return false;
+      return Match{.token = tks::Error{tks::Fault::OutOfRange}, .length = index};
     };
 
-    auto state = State::A;
-    auto index = std::size_t{0};
-
     while(true)
     {
       switch(state) 
       {
         case State::A:
-          if (is_in_alphabet(lexeme[index]) and std::isdigit(lexeme[index]))
+          if (detail::is_digit(detail::peek(lexeme, index)))
           {
+            detail::scan_digits(lexeme, index, mantissa);
             state = State::B;
-            ++index;
           }
-          else if (is_in_alphabet(lexeme[index]) and lexeme[index] == '.')
+          else if (detail::peek(lexeme, index) == '.')
           {
             state = State::C;
             ++index;
@@ -1339,12 +1479,7 @@ namespace analyzer
           break;
 
         case State::B:
-          if (is_in_alphabet(lexeme[index]) and std::isdigit(lexeme[index]))
-          {
-            state = State::B;
-            ++index;
-          }
-          else if (is_in_alphabet(lexeme[index]) and lexeme[index] == '.')
+          if (detail::peek(lexeme, index) == '.')
           {
             state = State::D;
             ++index;
@@ -1356,14 +1491,10 @@ namespace analyzer
           break;
 
         case State::C:
-          if (is_in_alphabet(lexeme[index]) and std::isdigit(lexeme[index]))
+          if (detail::is_digit(detail::peek(lexeme, index)))
           {
+            fraction = detail::scan_digits(lexeme, index, mantissa);
             state = State::E;
-            ++index;
-          }
-          else if (is_in_alphabet(lexeme[index]) and lexeme[index] == '.')
-          {
-            state = State::F;
           }
           else
           {
@@ -1372,50 +1503,11 @@ namespace analyzer
           break;
 
         case State::D:
-          if(index == lexeme.size())
-          {
-            return tks::FloatNum{.value = detail::parse_number<double>(lexeme)};
-          }
-          else 
-          {
-            if (is_in_alphabet(lexeme[index]) and std::isdigit(lexeme[index]))
-            {
-              state = State::D;
-              ++index;
-            }
-            else if (is_in_alphabet(lexeme[index]) and lexeme[index] == '.')
-            {
-              state = State::F;
-            }
-            else
-            {
-              state = State::F;
-            }
-          }
-          break;
+          fraction = detail::scan_digits(lexeme, index, mantissa);
+          return accept();
 
         case State::E:
-          if(index == lexeme.size())
-          {
-            return tks::FloatNum{.value = detail::parse_number<double>(lexeme)};
-          }
-          else 
-          {
-            if (is_in_alphabet(lexeme[index]) and std::isdigit(lexeme[index]))
-            {
-              state = State::E;
-              ++index;
-            }
-            else if (is_in_alphabet(lexeme[index]) and lexeme[index] == '.')
-            {
-              state = State::F;
-            }
-            else
-            {
-              state = State::F;
-            }
-          }
-          break;
+          return accept();
 
         case State::F: return Err;
       }
@@ -1423,53 +1515,197 @@ namespace analyzer
     std::unreachable();
   }
 
-  constexpr std::string parse_all(std::string lexeme, std::size_t line)
+  // Tried in order, the first match wins; keywords come before identifier.
+  constant recognizers =
+    std::array
   {
-    constant parsers =
-      std::array
-    {
-      symbol, 
-      if_kw,
-      else_kw,
-      for_kw,
-      elif_kw,
-      proc_kw,
-      var_kw,
-      run_kw,
-      return_kw,
-      int_kw,
-      float_kw,
-      True_kw,
-      False_kw,
-      bool_kw,
-      int_num_kw,
-      float_num_kw,
-      identifier
-    };
-
-    for (auto parser : parsers)
+    symbol, 
+    if_kw,
+    else_kw,
+    for_kw,
+    elif_kw,
+    proc_kw,
+    var_kw,
+    run_kw,
+    return_kw,
+    int_kw,
+    float_kw,
+    True_kw,
+    False_kw,
+    bool_kw,
+    int_num_kw,
+    float_num_kw,
+    identifier
+  };
+
+  // Runs the recognizers over one lexeme; only a match covering all of it
+  // counts. Identifiers come back unnumbered and literals unpooled, so this
+  // also runs in constant evaluation (see embedded.hpp).
+  constexpr std::optional<Match> classify(std::string_view lexeme)
+  {
+    for (auto recognizer : recognizers)
     {
-      if (auto res = parser(lexeme))
+      if (auto match = recognizer(lexeme); match and match->length == lexeme.size())
       {
-        return tks::to_string(*res);
+        return *match;
       }
     }
 
-    if (auto suggestion = find_suggestion(lexeme); !suggestion.empty()) 
+    return std::nullopt;
+  }
+
+  // classify() with identifiers numbered by this thread's table and literals
+  // pooled.
+  inline std::optional<Token> recognize(std::string_view lexeme)
+  {
+    auto match = classify(lexeme);
+    if (not match)
     {
+      return std::nullopt;
+    }
+
+    auto& token = match->token;
+    if (auto* id = std::get_if<tks::Id>(&token))
+    {
+      id->symbol = intern(lexeme);
+    }
+    else if (auto* number = std::get_if<tks::IntNum>(&token))
+    {
+      number->literal = constants::pool().intern(match->literal);
+    }
+    else if (auto* number = std::get_if<tks::FloatNum>(&token))
+    {
+      number->literal = constants::pool().intern(match->literal);
+    }
+
+    return token;
+  }
+
+  inline Token parse_all(std::string_view lexeme, tks::Span span, diag::Sink& diagnostics, bool interactive = false)
+  {
+    // Interactive corrections replace the lexeme and go round again, so the
+    // stack stays flat however many tries it takes.
+    auto replacement = std::string{};
+
+    while (true)
+    {
+      if (auto token = recognize(lexeme))
+      {
+        if (const auto* error = std::get_if<tks::Error>(&*token))
+        {
+          diagnostics.report({.span = span, .lexeme = std::string{lexeme}, .suggestion = {}, .fault = error->fault});
+        }
+        return *token;
+      }
+
+      // Bytes that are not UTF-8 are not a misspelling of anything: no
+      // suggestion and no prompt.
+      if (utf8::validate(lexeme))
+      {
+        diagnostics.report({.span = span, .lexeme = std::string{lexeme}, .suggestion = {}, .fault = tks::Fault::InvalidEncoding});
+        return tks::Error{tks::Fault::InvalidEncoding};
+      }
+
+      if (not interactive)
+      {
+        break;
+      }
+
+      auto suggestion = suggest(lexeme);
+      if (suggestion.empty())
+      {
+        break;
+      }
+
       std::print(std::cout,
           "[Error] <UNKNOWN_TOKEN \"{}\"> at line {}. Did you mean \"{}\"? ",
           lexeme,
-          line,
+          diagnostics.location(span).line,
           suggestion
       );
 
-      auto new_token = std::string{};
-      std::cin >> new_token;
-      return parse_all(new_token, line);
+      if (not (std::cin >> replacement))
+      {
+        break;
+      }
+      lexeme = replacement;
+    }
+
+    // Recover: the bad lexeme becomes an error token and lexing goes on with
+    // the next one, so a single run surfaces every problem up to the limit.
+    // The suggestion lookup is the expensive part, skip it once nothing more gets shown.
+    auto suggestion = diagnostics.full() ? std::string{} : suggest(lexeme);
+    diagnostics.report({.span = span, .lexeme = std::string{lexeme}, .suggestion = std::move(suggestion)});
+
+    return tks::Error{};
+  }
+
+  namespace detail
+  {
+
+    // Span of the next lexeme at or after `index`, advancing `index` past it.
+    // Lexemes are separated by spaces and newlines.
+    constexpr auto next_lexeme(std::string_view source, std::size_t& index) -> std::optional<tks::Span>
+    {
+      auto is_separator = [](char ch) { return ch == ' ' or ch == '\n'; };
+
+      while (index < source.size() and is_separator(source[index]))
+      {
+        ++index;
+      }
+
+      if (index == source.size())
+      {
+        return std::nullopt;
+      }
+
+      const auto start = index;
+      while (index < source.size() and not is_separator(source[index]))
+      {
+        ++index;
+      }
+
+      return tks::Span
+      {
+        .offset = static_cast<std::uint32_t>(start),
+        .length = static_cast<std::uint32_t>(index - start)
+      };
+    }
+
+  }
+
+  // Splits a whole source buffer on spaces and newlines and recognizes every
+  // lexeme, keeping its byte span so positions survive the split. Tokens are
+  // handed to `emit` one by one, in source order.
+  template<typename Emit>
+  void lex_each(std::string_view source, diag::Sink& diagnostics, bool interactive, Emit&& emit)
+  {
+    auto index = std::size_t{0};
+    while (auto span = detail::next_lexeme(source, index))
+    {
+      emit(tks::Spanned{parse_all(source.substr(span->offset, span->length), *span, diagnostics, interactive), *span});
     }
+  }
+
+  // Lazy form of lex_each: nothing past the last token pulled gets lexed, so
+  // a consumer that stops early does not pay for the rest of the file.
+  inline std::generator<tks::Spanned> tokens(std::string_view source, diag::Sink& diagnostics)
+  {
+    auto index = std::size_t{0};
+    while (auto span = detail::next_lexeme(source, index))
+    {
+      co_yield tks::Spanned{parse_all(source.substr(span->offset, span->length), *span, diagnostics), *span};
+    }
+  }
+
+  inline std::vector<tks::Spanned> lex(std::string_view source, diag::Sink& diagnostics, bool interactive = false)
+  {
+    auto tokens = std::vector<tks::Spanned>{};
+    tokens.reserve(source.size() / 4);
+
+    lex_each(source, diagnostics, interactive, [&tokens](const tks::Spanned& token) { tokens.push_back(token); });
 
-    return std::format("<ERROR_TOKEN \"{}\" at line {}>", lexeme, line);
+    return tokens;
   }
 
 }
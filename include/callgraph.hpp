@@ -0,0 +1,402 @@
+#pragma once
+
+#include "tokens.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <ostream>
+#include <print>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#if not defined(constant)
+#define constant static constexpr auto
+#endif
+
+namespace callgraph
+{
+
+  // Procs whose whole definition is at most this many tokens are inline
+  // candidates, as long as they cannot reach themselves.
+  constant inline_budget = std::size_t{32};
+
+  namespace detail
+  {
+
+    template<typename ...Ts>
+    constexpr auto holds_any(const Token& token) -> bool
+    {
+      return (std::holds_alternative<Ts>(token) or ...);
+    }
+
+    // Tokens that would combine a call's result with something else.
+    constexpr auto is_operator(const Token& token) -> bool
+    {
+      return holds_any<tks::Assign, tks::Plus, tks::Minus, tks::Mul, tks::Devide,
+                       tks::Equal, tks::Unequal, tks::GrEqual, tks::LeEqual, tks::Greater, tks::Less>(token);
+    }
+
+  }
+
+  struct Call
+  {
+    std::size_t callee;
+    std::size_t site;  // index of the `run` token
+    bool        tail;  // the whole return expression, `return run _x ...` or `return ( run _x ... )`
+  };
+
+  struct Proc
+  {
+    std::string_view  name;
+    std::size_t       first; // index of the `proc` token
+    std::size_t       last;  // index of its closing brace
+    std::vector<Call> calls; // `run _x` in the body that name a known proc
+  };
+
+  // Procs and `run` edges recovered from the token stream: a proc runs from
+  // `proc _name` to the brace matching the first `{` after it.
+  class Graph
+  {
+  public:
+    Graph(std::span<const tks::Spanned> tokens, std::string_view source)
+    {
+      struct Site
+      {
+        std::string_view callee;
+        std::size_t      site;
+        bool             tail;
+      };
+
+      auto sites = std::vector<std::vector<Site>>{};
+      auto name  = [&](std::size_t index) { return source.substr(tokens[index].span.offset, tokens[index].span.length); };
+      auto is    = [&]<typename T>(std::size_t index, T) { return index < tokens.size() and std::holds_alternative<T>(tokens[index].token); };
+
+      // Whether a line break separates token `index` from the one before it.
+      auto starts_line = [&](std::size_t index)
+      {
+        const auto end = tokens[index - 1].span.offset + tokens[index - 1].span.length;
+        return source.substr(end, tokens[index].span.offset - end).contains('\n');
+      };
+
+      // A call at `site` is a tail call when it is the whole return
+      // expression: `return`, any number of `(`, the call, and after its
+      // arguments nothing but the matching `)` up to the end of the line or
+      // a `}`. An operator outside the arguments means work is left.
+      auto tail = [&](std::size_t site)
+      {
+        auto wrapping = std::size_t{0};
+        auto before   = site;
+        while (before != 0 and is(before - 1, tks::ParanOpen{}))
+        {
+          ++wrapping;
+          --before;
+        }
+
+        if (before == 0 or not is(before - 1, tks::Return{}))
+        {
+          return false;
+        }
+
+        const auto wrapped = wrapping != 0;
+
+        auto depth = std::size_t{0}; // inside the call's own argument parentheses
+        for (auto at = site + 2; at < tokens.size() and not starts_line(at) and not is(at, tks::BraceClose{}); ++at)
+        {
+          if (is(at, tks::ParanOpen{}))
+          {
+            ++depth;
+          }
+          else if (is(at, tks::ParanClose{}) and depth != 0)
+          {
+            --depth;
+          }
+          else if (is(at, tks::ParanClose{}) and wrapping != 0)
+          {
+            --wrapping;
+          }
+          else if (is(at, tks::ParanClose{}))
+          {
+            return false;
+          }
+          else if (depth == 0 and (detail::is_operator(tokens[at].token) or (wrapped and wrapping == 0)))
+          {
+            return false;
+          }
+        }
+
+        return wrapping == 0;
+      };
+
+      for (auto index = std::size_t{0}; index < tokens.size(); ++index)
+      {
+        if (not is(index, tks::Proc{}) or not is(index + 1, tks::Id{}))
+        {
+          continue;
+        }
+
+        auto proc  = Proc{.name = name(index + 1), .first = index, .last = tokens.size() - 1, .calls = {}};
+        auto depth = std::size_t{0};
+        auto body  = std::vector<Site>{};
+
+        for (auto at = index + 2; at < tokens.size(); ++at)
+        {
+          if (is(at, tks::Run{}) and is(at + 1, tks::Id{}))
+          {
+            body.push_back({.callee = name(at + 1), .site = at, .tail = tail(at)});
+          }
+          else if (is(at, tks::BraceOpen{}))
+          {
+            ++depth;
+          }
+          else if (is(at, tks::BraceClose{}) and depth != 0 and --depth == 0)
+          {
+            proc.last = at;
+            break;
+          }
+          else if (is(at, tks::Proc{}) and depth == 0)
+          {
+            proc.last = at - 1;
+            break;
+          }
+        }
+
+        index = proc.last;
+        by_name_.try_emplace(proc.name, procs_.size());
+        procs_.push_back(proc);
+        sites.push_back(std::move(body));
+      }
+
+      for (auto p = std::size_t{0}; p < procs_.size(); ++p)
+      {
+        for (const auto& site : sites[p])
+        {
+          if (auto found = find(site.callee))
+          {
+            procs_[p].calls.push_back({.callee = *found, .site = site.site, .tail = site.tail});
+          }
+        }
+      }
+
+      find_recursion();
+    }
+
+    [[nodiscard]]
+    auto procs() const -> const std::vector<Proc>&
+    {
+      return procs_;
+    }
+
+    [[nodiscard]]
+    auto find(std::string_view name) const -> std::optional<std::size_t>
+    {
+      const auto it = by_name_.find(name);
+      return it != by_name_.end() ? std::optional{it->second} : std::nullopt;
+    }
+
+    // Procs reachable from `root`, root included.
+    [[nodiscard]]
+    auto reachable(std::size_t root) const -> std::vector<bool>
+    {
+      auto seen  = std::vector<bool>(procs_.size(), false);
+      auto stack = std::vector<std::size_t>{root};
+      seen[root] = true;
+
+      while (not stack.empty())
+      {
+        const auto p = stack.back();
+        stack.pop_back();
+
+        for (const auto& call : procs_[p].calls)
+        {
+          if (not seen[call.callee])
+          {
+            seen[call.callee] = true;
+            stack.push_back(call.callee);
+          }
+        }
+      }
+      return seen;
+    }
+
+    // Whether `p` can end up running itself again.
+    [[nodiscard]]
+    auto recursive(std::size_t p) const -> bool
+    {
+      return recursive_[p];
+    }
+
+  private:
+    // Tarjan's strongly connected components, once for the whole graph: a
+    // proc is recursive when its component has other members or it runs
+    // itself directly. Iterative, so long call chains cannot overflow the
+    // stack.
+    void find_recursion()
+    {
+      constant unvisited = static_cast<std::size_t>(-1);
+
+      auto order    = std::vector<std::size_t>(procs_.size(), unvisited); // discovery index
+      auto low      = std::vector<std::size_t>(procs_.size(), 0);
+      auto on_stack = std::vector<bool>(procs_.size(), false);
+      auto stack    = std::vector<std::size_t>{};
+      auto frames   = std::vector<std::pair<std::size_t, std::size_t>>{};  // proc, next call to follow
+      auto visited  = std::size_t{0};
+
+      recursive_.assign(procs_.size(), false);
+
+      auto enter = [&](std::size_t p)
+      {
+        order[p] = low[p] = visited++;
+        stack.push_back(p);
+        on_stack[p] = true;
+        frames.emplace_back(p, 0);
+      };
+
+      for (auto root = std::size_t{0}; root < procs_.size(); ++root)
+      {
+        if (order[root] != unvisited)
+        {
+          continue;
+        }
+        enter(root);
+
+        while (not frames.empty())
+        {
+          const auto p = frames.back().first;
+
+          if (auto& next = frames.back().second; next < procs_[p].calls.size())
+          {
+            const auto q = procs_[p].calls[next++].callee;
+            if (q == p)
+            {
+              recursive_[p] = true;
+            }
+
+            if (order[q] == unvisited)
+            {
+              enter(q);
+            }
+            else if (on_stack[q])
+            {
+              low[p] = std::min(low[p], order[q]);
+            }
+            continue;
+          }
+
+          frames.pop_back();
+          if (not frames.empty())
+          {
+            const auto parent = frames.back().first;
+            low[parent] = std::min(low[parent], low[p]);
+          }
+
+          if (low[p] != order[p])
+          {
+            continue;
+          }
+
+          auto members = stack.end();
+          do
+          {
+            --members;
+          }
+          while (*members != p);
+
+          for (auto it = members; it != stack.end(); ++it)
+          {
+            on_stack[*it] = false;
+            recursive_[*it] = recursive_[*it] or stack.end() - members > 1;
+          }
+          stack.erase(members, stack.end());
+        }
+      }
+    }
+
+    std::vector<Proc>                                  procs_;
+    std::unordered_map<std::string_view, std::size_t> by_name_;
+    std::vector<bool>                                  recursive_; // per proc, see recursive()
+  };
+
+  struct Pruned
+  {
+    std::vector<bool>             keep;               // per token
+    bool                          has_main       = false;
+    std::size_t                   procs          = 0;
+    std::size_t                   dropped        = 0;
+    std::size_t                   dropped_tokens = 0;
+    std::vector<std::string_view> inline_candidates;
+  };
+
+  // Marks the tokens of procs unreachable from `_main` as dropped and lists
+  // the small, non-recursive live procs that are called from somewhere.
+  // Without a `_main` nothing is dropped.
+  inline auto prune(std::span<const tks::Spanned> tokens, std::string_view source) -> Pruned
+  {
+    const auto  graph = Graph{tokens, source};
+    const auto& procs = graph.procs();
+
+    auto result = Pruned{.keep = std::vector<bool>(tokens.size(), true), .procs = procs.size(), .inline_candidates = {}};
+
+    const auto main = graph.find("_main");
+    if (not main)
+    {
+      return result;
+    }
+    result.has_main = true;
+
+    const auto live   = graph.reachable(*main);
+    auto       called = std::vector<bool>(procs.size(), false);
+
+    for (auto p = std::size_t{0}; p < procs.size(); ++p)
+    {
+      if (live[p])
+      {
+        for (const auto& call : procs[p].calls)
+        {
+          called[call.callee] = true;
+        }
+        continue;
+      }
+
+      ++result.dropped;
+      result.dropped_tokens += procs[p].last - procs[p].first + 1;
+      std::fill(result.keep.begin() + procs[p].first, result.keep.begin() + procs[p].last + 1, false);
+    }
+
+    for (auto p = std::size_t{0}; p < procs.size(); ++p)
+    {
+      if (live[p] and called[p] and procs[p].last - procs[p].first + 1 <= inline_budget and not graph.recursive(p))
+      {
+        result.inline_candidates.push_back(procs[p].name);
+      }
+    }
+
+    return result;
+  }
+
+  inline void report(const Pruned& pruned, std::size_t tokens, std::ostream& out)
+  {
+    if (not pruned.has_main)
+    {
+      std::println(out, "[INFO] no _main proc, nothing dropped.");
+      return;
+    }
+
+    std::println(out, "[INFO] dropped {} of {} proc(s) unreachable from _main ({} of {} tokens).",
+                 pruned.dropped, pruned.procs, pruned.dropped_tokens, tokens);
+
+    if (not pruned.inline_candidates.empty())
+    {
+      std::print(out, "[INFO] inline candidates (at most {} tokens, not recursive):", inline_budget);
+      for (auto name : pruned.inline_candidates)
+      {
+        std::print(out, " {}", name);
+      }
+      std::println(out, "");
+    }
+  }
+
+}
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Literal constants, stored once per pool. Tokens refer to an entry by its
+// 32-bit index, which keeps every token payload at four bytes, and two
+// literals of the same pool are the same constant exactly when their indices
+// are equal. A compilation, an LSP document or a watched file lends its own
+// pool to the threads that lex it (PoolScope), so long-running modes free
+// their constants along with the tokens; everything else shares the
+// process pool.
+namespace constants
+{
+
+  // An integer or float literal value; floats are compared by their bits.
+  struct Literal
+  {
+    bool          floating = false;
+    std::uint64_t bits     = 0;
+
+    [[nodiscard]]
+    static constexpr auto integer(std::uint64_t value) -> Literal
+    {
+      return {.floating = false, .bits = value};
+    }
+
+    [[nodiscard]]
+    static constexpr auto real(double value) -> Literal
+    {
+      return {.floating = true, .bits = std::bit_cast<std::uint64_t>(value)};
+    }
+
+    [[nodiscard]]
+    constexpr auto as_integer() const -> std::uint64_t
+    {
+      return bits;
+    }
+
+    [[nodiscard]]
+    constexpr auto as_double() const -> double
+    {
+      return std::bit_cast<double>(bits);
+    }
+
+    friend constexpr auto operator==(const Literal&, const Literal&) -> bool = default;
+  };
+
+  namespace detail
+  {
+
+    // Float bits keep their entropy in the top bytes, so they are mixed down
+    // before the table reduces them to a bucket.
+    struct literal_hash
+    {
+      auto operator()(const Literal& literal) const -> std::size_t
+      {
+        const auto mixed = (literal.bits ^ literal.floating) * 0x9E3779B97F4A7C15;
+        return static_cast<std::size_t>(mixed ^ (mixed >> 32));
+      }
+    };
+
+    // Open-addressing map from literal to index, one per thread in front of
+    // the shared table. A lookup is usually a single probe into one flat
+    // array, which matters since every number token goes through it. It
+    // remembers the pool it was filled from and starts over for another one.
+    class Cache
+    {
+    public:
+      [[nodiscard]]
+      auto owner() const -> std::uint64_t
+      {
+        return owner_;
+      }
+
+      void reset(std::uint64_t owner)
+      {
+        slots_ = {};
+        size_  = 0;
+        owner_ = owner;
+      }
+
+      [[nodiscard]]
+      auto find(const Literal& literal) const -> std::optional<std::uint32_t>
+      {
+        if (slots_.empty())
+        {
+          return std::nullopt;
+        }
+
+        for (auto at = literal_hash{}(literal) & (slots_.size() - 1); slots_[at].used; at = (at + 1) & (slots_.size() - 1))
+        {
+          if (slots_[at].bits == literal.bits and slots_[at].floating == literal.floating)
+          {
+            return slots_[at].index;
+          }
+        }
+        return std::nullopt;
+      }
+
+      void insert(const Literal& literal, std::uint32_t index)
+      {
+        if (2 * (size_ + 1) > slots_.size())
+        {
+          grow();
+        }
+
+        auto at = literal_hash{}(literal) & (slots_.size() - 1);
+        while (slots_[at].used)
+        {
+          at = (at + 1) & (slots_.size() - 1);
+        }
+        slots_[at] = {.bits = literal.bits, .index = index, .floating = literal.floating, .used = true};
+        ++size_;
+      }
+
+    private:
+      // Sixteen bytes, four to a cache line.
+      struct Slot
+      {
+        std::uint64_t bits     = 0;
+        std::uint32_t index    = 0;
+        bool          floating = false;
+        bool          used     = false;
+      };
+
+      void grow()
+      {
+        auto old = std::exchange(slots_, std::vector<Slot>(std::max<std::size_t>(64, 2 * slots_.size())));
+        size_ = 0;
+        for (const auto& slot : old)
+        {
+          if (slot.used)
+          {
+            insert({.floating = slot.floating, .bits = slot.bits}, slot.index);
+          }
+        }
+      }
+
+      std::vector<Slot> slots_;
+      std::size_t       size_  = 0;
+      std::uint64_t     owner_ = 0;
+    };
+
+  }
+
+  // Append-only and shared by every thread that lexes into it. Entries live
+  // in segments that double in size and never move, so reading one takes no
+  // lock; interning a new value does, but each thread remembers what it has
+  // interned, so recurring constants (0, 1, 42) only touch the lock once per
+  // thread.
+  class Pool
+  {
+  public:
+    Pool()
+      : id_{next_id.fetch_add(1, std::memory_order_relaxed)}
+    {
+    }
+
+    Pool(const Pool&)            = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    ~Pool()
+    {
+      for (auto& segment : segments_)
+      {
+        delete[] segment.load();
+      }
+    }
+
+    [[nodiscard]]
+    auto intern(Literal literal) -> std::uint32_t
+    {
+      // Ids are never reused, unlike addresses, so a cache is never taken
+      // for that of a pool that used to live at the same place.
+      thread_local auto seen = detail::Cache{};
+
+      if (seen.owner() != id_)
+      {
+        seen.reset(id_);
+      }
+
+      if (const auto index = seen.find(literal))
+      {
+        return *index;
+      }
+
+      auto lock        = std::scoped_lock{mutex_};
+      auto [it, added] = indices_.try_emplace(literal, static_cast<std::uint32_t>(indices_.size()));
+
+      if (added)
+      {
+        const auto [segment, slot] = locate(it->second);
+        if (segments_[segment].load(std::memory_order_relaxed) == nullptr)
+        {
+          segments_[segment].store(new Literal[first_segment << segment], std::memory_order_release);
+        }
+        segments_[segment].load(std::memory_order_relaxed)[slot] = literal;
+      }
+
+      seen.insert(literal, it->second);
+      return it->second;
+    }
+
+    // Any index a token carries is readable from any thread the token got to.
+    [[nodiscard]]
+    auto operator[](std::uint32_t index) const -> Literal
+    {
+      const auto [segment, slot] = locate(index);
+      return segments_[segment].load(std::memory_order_acquire)[slot];
+    }
+
+    [[nodiscard]]
+    auto size() const -> std::size_t
+    {
+      auto lock = std::scoped_lock{mutex_};
+      return indices_.size();
+    }
+
+  private:
+    static constexpr auto first_segment = std::size_t{64};
+
+    static inline auto next_id = std::atomic<std::uint64_t>{1};
+
+    // Segment k holds first_segment << k entries, enough for all 2^32 indices.
+    static constexpr auto locate(std::uint32_t index) -> std::pair<std::size_t, std::size_t>
+    {
+      const auto scaled  = std::uint64_t{index} / first_segment + 1;
+      const auto segment = static_cast<std::size_t>(std::bit_width(scaled) - 1);
+      return {segment, std::uint64_t{index} - first_segment * ((std::uint64_t{1} << segment) - 1)};
+    }
+
+    std::uint64_t                                                    id_;
+    mutable std::mutex                                               mutex_;
+    std::unordered_map<Literal, std::uint32_t, detail::literal_hash> indices_;
+    std::array<std::atomic<Literal*>, 27>                            segments_ = {};
+  };
+
+  namespace detail
+  {
+
+    inline thread_local Pool* lent_pool = nullptr;
+
+  }
+
+  // The pool this thread interns into and reads from.
+  inline auto pool() -> Pool&
+  {
+    if (detail::lent_pool != nullptr)
+    {
+      return *detail::lent_pool;
+    }
+
+    static auto instance = Pool{};
+    return instance;
+  }
+
+  // Makes `pool` the calling thread's pool until it goes out of scope.
+  class PoolScope
+  {
+  public:
+    explicit PoolScope(Pool& pool)
+      : previous_{std::exchange(detail::lent_pool, &pool)}
+    {
+    }
+
+    PoolScope(const PoolScope&)            = delete;
+    PoolScope& operator=(const PoolScope&) = delete;
+
+    ~PoolScope()
+    {
+      detail::lent_pool = previous_;
+    }
+
+  private:
+    Pool* previous_;
+  };
+
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "source.hpp"
+#include "tokens.hpp"
+#include "utf8.hpp"
+
+#include <cstddef>
+#include <format>
+#include <ostream>
+#include <print>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace diag
+{
+
+  struct Diagnostic
+  {
+    tks::Span   span;
+    std::string lexeme;
+    std::string suggestion;
+    tks::Fault  fault = tks::Fault::UnknownLexeme;
+  };
+
+  // "<UNKNOWN_TOKEN "x">" style tag used wherever a diagnostic is shown.
+  [[nodiscard]]
+  inline auto describe(const Diagnostic& diagnostic) -> std::string
+  {
+    switch (diagnostic.fault)
+    {
+      case tks::Fault::OutOfRange:      return std::format("<NUMBER_OUT_OF_RANGE \"{}\">", diagnostic.lexeme);
+      case tks::Fault::InvalidEncoding: return std::format("<INVALID_UTF8 \"{}\">", utf8::escape(diagnostic.lexeme));
+      default:                          return std::format("<UNKNOWN_TOKEN \"{}\">", diagnostic.lexeme);
+    }
+  }
+
+  // Collects diagnostics of a single run. Only the first `limit` ones are kept,
+  // the rest are counted so the summary can still tell how many were dropped.
+  class Sink
+  {
+  public:
+    Sink(std::size_t limit, const src::LineIndex& lines) : limit_{limit}, lines_{lines}
+    {
+    }
+
+    [[nodiscard]]
+    auto location(tks::Span span) const -> src::Location
+    {
+      return lines_.location(span.offset);
+    }
+
+    [[nodiscard]]
+    auto limit() const -> std::size_t
+    {
+      return limit_;
+    }
+
+    [[nodiscard]]
+    auto full() const -> bool
+    {
+      return diagnostics_.size() >= limit_;
+    }
+
+    [[nodiscard]]
+    auto count() const -> std::size_t
+    {
+      return diagnostics_.size() + dropped_;
+    }
+
+    [[nodiscard]]
+    auto entries() const -> const std::vector<Diagnostic>&
+    {
+      return diagnostics_;
+    }
+
+    void report(Diagnostic diagnostic)
+    {
+      if (full())
+      {
+        ++dropped_;
+        return;
+      }
+
+      diagnostics_.push_back(std::move(diagnostic));
+    }
+
+    // For suggestions that can only be made once more of the file is known.
+    void amend_suggestion(std::size_t index, std::string suggestion)
+    {
+      diagnostics_.at(index).suggestion = std::move(suggestion);
+    }
+
+    // Appends what another sink collected, as if it had been reported here
+    // in order; used to join sinks that covered consecutive parts of a file.
+    void merge(const Sink& other)
+    {
+      for (const auto& diagnostic : other.diagnostics_)
+      {
+        report(diagnostic);
+      }
+      dropped_ += other.dropped_;
+    }
+
+    void flush(std::ostream& out) const
+    {
+      for (const auto& diagnostic : diagnostics_)
+      {
+        const auto [line, column] = location(diagnostic.span);
+        std::print(out, "[Error] {} at line {}, column {}.", describe(diagnostic), line, column);
+
+        if (not diagnostic.suggestion.empty())
+        {
+          std::print(out, " Did you mean \"{}\"?", diagnostic.suggestion);
+        }
+
+        std::println(out, "");
+      }
+
+      if (dropped_ != 0)
+      {
+        std::println(out, "[INFO] {} more error(s) not shown (limit is {}).", dropped_, limit_);
+      }
+    }
+
+  private:
+    std::size_t             limit_;
+    const src::LineIndex&   lines_;
+    std::size_t             dropped_ = 0;
+    std::vector<Diagnostic> diagnostics_;
+  };
+
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "analyzers.hpp"
+#include "callgraph.hpp"
+#include "constants.hpp"
+#include "diagnostics.hpp"
+#include "memory.hpp"
+#include "options.hpp"
+#include "output.hpp"
+#include "parallel.hpp"
+#include "pipeline.hpp"
+#include "source.hpp"
+#include "tokens.hpp"
+#include "trace.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <cstdlib>
+#include <memory_resource>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace driver
+{
+
+  inline void report(const diag::Sink& diagnostics, std::ostream& console)
+  {
+    auto scope = trace::Scope{"diagnostics"};
+    auto phase = mem::Phase{"diagnostics"};
+    diagnostics.flush(console);
+  }
+
+  // Rough footprint of this thread's identifier table: nodes and spilled
+  // strings are in use, the bucket array is what the table keeps reserved.
+  inline auto interner_usage() -> mem::Usage
+  {
+    const auto& table = analyzer::identifiers().table;
+
+    auto used = std::size_t{0};
+    for (const auto& [name, symbol] : table)
+    {
+      used += sizeof(std::pair<const std::pmr::string, std::size_t>) + 2 * sizeof(void*);
+      used += name.capacity() > std::pmr::string{}.capacity() ? name.capacity() + 1 : 0;
+    }
+    return {.name = "interner", .used = used, .reserved = used + table.bucket_count() * sizeof(void*)};
+  }
+
+  // One full compilation of `source`: the token lines (what ends up in
+  // out.txt) go to `out`, the diagnostics summary to `console`. Returns the
+  // process exit status a cold run would have. Shared by main and the server;
+  // the server passes its warm `workers` for --jobs instead of having every
+  // compilation start threads of its own.
+  inline auto compile(std::string_view source, std::ostream& out, std::ostream& console, const cli::Options& options,
+                      conc::WorkStealingPool* workers = nullptr) -> int
+  {
+    analyzer::reset_identifiers();
+
+    // Constants live as long as the tokens that refer to them, so a server
+    // thread does not keep every literal it ever lexed.
+    auto literals = constants::Pool{};
+    auto lent     = constants::PoolScope{literals};
+
+    // Line starts and, with pruning, the token stream die with this
+    // compilation, so they share an arena that is released in one step. A
+    // pool rather than a monotonic buffer, so their growth copies are given
+    // back as they go. Only the calling thread allocates from it: workers
+    // and the pipeline's lexer hand their tokens back through `emit`.
+    auto arena = std::pmr::unsynchronized_pool_resource{};
+
+    const auto lines = src::LineIndex{source, &arena};
+
+    auto diagnostics = diag::Sink{options.max_errors, lines};
+    auto writer      = output::LineWriter{out, lines};
+
+    auto lex = [&](auto&& emit)
+    {
+      auto scope = trace::Scope{"lex"};
+      auto phase = mem::Phase{"lex"};
+
+      if (options.pipeline)
+      {
+        pipeline::run(source, diagnostics, {.batch_size = options.batch_size, .ring_capacity = options.ring_capacity}, emit);
+      }
+      else if (options.jobs > 1 and workers != nullptr)
+      {
+        parallel::lex_each(source, diagnostics, lines, *workers, emit);
+      }
+      else if (options.jobs > 1)
+      {
+        // The calling thread takes part, so it counts as one of the jobs.
+        auto pool = conc::WorkStealingPool{options.jobs - 1};
+        parallel::lex_each(source, diagnostics, lines, pool, emit);
+      }
+      else
+      {
+        analyzer::lex_each(source, diagnostics, options.interactive, emit);
+      }
+    };
+
+    if (not options.prune_procs)
+    {
+      lex([&writer](const tks::Spanned& token) { writer.write(token); });
+      writer.finish();
+      if (mem::recording())
+      {
+        mem::note(interner_usage());
+      }
+      report(diagnostics, console);
+
+      return diagnostics.count() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Pruning needs the whole call graph before anything is written. A
+    // token per four bytes of source is reserved up front, so the stream
+    // rarely has to grow.
+    auto tokens = std::pmr::vector<tks::Spanned>{&arena};
+    tokens.reserve(source.size() / 4);
+    lex([&tokens](const tks::Spanned& token) { tokens.push_back(token); });
+
+    const auto pruned = [&]
+    {
+      auto scope = trace::Scope{"prune"};
+      auto phase = mem::Phase{"prune"};
+      return callgraph::prune(tokens, source);
+    }();
+
+    {
+      auto scope = trace::Scope{"emit"};
+      auto phase = mem::Phase{"emit"};
+      for (auto index = std::size_t{0}; index < tokens.size(); ++index)
+      {
+        if (pruned.keep[index])
+        {
+          writer.write(tokens[index]);
+        }
+      }
+      writer.finish();
+    }
+
+    if (mem::recording())
+    {
+      mem::note(interner_usage());
+      mem::note({.name = "tokens", .used = tokens.size() * sizeof(tks::Spanned), .reserved = tokens.capacity() * sizeof(tks::Spanned)});
+    }
+    report(diagnostics, console);
+    callgraph::report(pruned, tokens.size(), console);
+
+    return diagnostics.count() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "analyzers.hpp"
+#include "constants.hpp"
+#include "tokens.hpp"
+#include "utf8.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <variant>
+
+// Lexing of scripts embedded in a host program, done by the compiler:
+//
+//   constexpr auto& script = embedded::script<"proc _main { return 0 }">;
+//
+// holds a std::array of tks::Spanned computed at build time, the same tokens
+// analyzer::lex would give at run time for that text, except that number
+// tokens index the script's own literal table rather than constants::pool(),
+// which only exists at run time. Unknown lexemes become error tokens as in
+// out.txt; nothing is reported, so check for tks::Error with a static_assert
+// where that matters. Float literals outside the exact fast path stop the
+// build, their conversion is not constexpr.
+namespace embedded
+{
+
+  // A string literal that can be passed as a template argument.
+  template<std::size_t N>
+  struct Source
+  {
+    char text[N] = {};
+
+    constexpr Source(const char (&literal)[N])
+    {
+      std::copy_n(literal, N, text);
+    }
+
+    [[nodiscard]]
+    constexpr auto view() const -> std::string_view
+    {
+      return {text, N - 1};
+    }
+  };
+
+  // A table local to one lex() call, numbering distinct values from 0 in
+  // order of first occurrence.
+  template<typename T, std::size_t Capacity>
+  class Interner
+  {
+  public:
+    constexpr auto intern(const T& value) -> std::uint32_t
+    {
+      for (auto index = std::size_t{0}; index < size_; ++index)
+      {
+        if (values_[index] == value)
+        {
+          return static_cast<std::uint32_t>(index);
+        }
+      }
+
+      values_[size_] = value;
+      return static_cast<std::uint32_t>(size_++);
+    }
+
+    [[nodiscard]]
+    constexpr auto operator[](std::uint32_t index) const -> const T&
+    {
+      return values_[index];
+    }
+
+  private:
+    std::array<T, Capacity> values_ = {};
+    std::size_t             size_   = 0;
+  };
+
+  template<std::size_t N>
+  struct Script
+  {
+    std::array<tks::Spanned, N>     tokens   = {};
+    Interner<constants::Literal, N> literals = {}; // what IntNum and FloatNum tokens index
+
+    [[nodiscard]]
+    constexpr auto value(tks::IntNum number) const -> std::uint64_t
+    {
+      return literals[number.literal].as_integer();
+    }
+
+    [[nodiscard]]
+    constexpr auto value(tks::FloatNum number) const -> double
+    {
+      return literals[number.literal].as_double();
+    }
+  };
+
+  namespace detail
+  {
+
+    // utf8::validate skips ASCII with vector loads, so it cannot run in
+    // constant evaluation; this is the same check one code point at a time.
+    constexpr auto well_formed(std::string_view text) -> bool
+    {
+      for (auto index = std::size_t{0}; index < text.size(); )
+      {
+        if (not utf8::decode(text, index))
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+
+  }
+
+  [[nodiscard]]
+  constexpr auto count(std::string_view source) -> std::size_t
+  {
+    auto index  = std::size_t{0};
+    auto tokens = std::size_t{0};
+
+    while (analyzer::detail::next_lexeme(source, index))
+    {
+      ++tokens;
+    }
+    return tokens;
+  }
+
+  // `source` has to hold exactly N lexemes, see count(). Identifiers are
+  // numbered from 1 in order of first occurrence, as analyzer::intern does
+  // on a fresh table.
+  template<std::size_t N>
+  constexpr auto lex(std::string_view source) -> Script<N>
+  {
+    auto script = Script<N>{};
+    auto names  = Interner<std::string_view, N>{};
+    auto index  = std::size_t{0};
+
+    for (auto& [token, span] : script.tokens)
+    {
+      span = *analyzer::detail::next_lexeme(source, index);
+
+      const auto lexeme = source.substr(span.offset, span.length);
+      const auto match  = analyzer::classify(lexeme);
+
+      token = match ? match->token : tks::Error{detail::well_formed(lexeme) ? tks::Fault::UnknownLexeme : tks::Fault::InvalidEncoding};
+
+      if (auto* id = std::get_if<tks::Id>(&token))
+      {
+        id->symbol = names.intern(lexeme) + 1;
+      }
+      else if (auto* number = std::get_if<tks::IntNum>(&token))
+      {
+        number->literal = script.literals.intern(match->literal);
+      }
+      else if (auto* number = std::get_if<tks::FloatNum>(&token))
+      {
+        number->literal = script.literals.intern(match->literal);
+      }
+    }
+
+    return script;
+  }
+
+  template<Source Text>
+  constexpr auto script = lex<count(Text.view())>(Text.view());
+
+}
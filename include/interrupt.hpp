@@ -0,0 +1,37 @@
+#pragma once
+
+#include <csignal>
+
+#include <pthread.h>
+#include <sys/signalfd.h>
+
+// SIGINT and SIGTERM as a descriptor that the long-running modes poll next
+// to their sockets or inotify, so Ctrl-C makes run() return and main still
+// gets to write the trace and the memory report.
+namespace interrupt
+{
+
+  inline auto signals() -> sigset_t
+  {
+    auto set = sigset_t{};
+    ::sigemptyset(&set);
+    ::sigaddset(&set, SIGINT);
+    ::sigaddset(&set, SIGTERM);
+    return set;
+  }
+
+  // Threads inherit the mask, so this has to run before any of them starts.
+  inline void block()
+  {
+    const auto set = signals();
+    ::pthread_sigmask(SIG_BLOCK, &set, nullptr);
+  }
+
+  // Readable once SIGINT or SIGTERM is pending, -1 on failure.
+  inline auto descriptor() -> int
+  {
+    const auto set = signals();
+    return ::signalfd(-1, &set, SFD_CLOEXEC | SFD_NONBLOCK);
+  }
+
+}
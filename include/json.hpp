@@ -0,0 +1,457 @@
+#pragma once
+
+#include "tokens.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace json
+{
+
+  struct Value;
+
+  using Array  = std::vector<Value>;
+  using Object = std::vector<std::pair<std::string, Value>>;
+
+  // Just enough JSON for the language server: objects keep insertion order
+  // and are searched linearly, which is fine for the handful of keys LSP uses.
+  struct Value
+  {
+    std::variant<std::nullptr_t, bool, std::int64_t, double, std::string, Array, Object> data;
+
+    Value()                   : data{nullptr}                   {}
+    Value(std::nullptr_t)     : data{nullptr}                   {}
+    Value(bool v)             : data{v}                         {}
+    Value(int v)              : data{std::int64_t{v}}           {}
+    Value(std::int64_t v)     : data{v}                         {}
+    Value(std::uint32_t v)    : data{std::int64_t{v}}           {}
+    Value(std::size_t v)      : data{static_cast<std::int64_t>(v)} {}
+    Value(double v)           : data{v}                         {}
+    Value(const char* v)      : data{std::string{v}}            {}
+    Value(std::string_view v) : data{std::string{v}}            {}
+    Value(std::string v)      : data{std::move(v)}              {}
+    Value(Array v)            : data{std::move(v)}              {}
+    Value(Object v)           : data{std::move(v)}              {}
+
+    [[nodiscard]]
+    auto find(std::string_view key) const -> const Value*
+    {
+      if (const auto* object = std::get_if<Object>(&data))
+      {
+        for (const auto& [name, value] : *object)
+        {
+          if (name == key)
+          {
+            return &value;
+          }
+        }
+      }
+      return nullptr;
+    }
+
+    // Follows a path of object keys, e.g. at("textDocument", "uri").
+    template<typename ...Keys>
+    [[nodiscard]]
+    auto at(std::string_view key, Keys... rest) const -> const Value*
+    {
+      const auto* value = find(key);
+      if constexpr (sizeof...(rest) == 0)
+      {
+        return value;
+      }
+      else
+      {
+        return value ? value->at(rest...) : nullptr;
+      }
+    }
+
+    [[nodiscard]]
+    auto as_string() const -> std::string_view
+    {
+      const auto* s = std::get_if<std::string>(&data);
+      return s ? std::string_view{*s} : std::string_view{};
+    }
+
+    [[nodiscard]]
+    auto as_int() const -> std::int64_t
+    {
+      if (const auto* i = std::get_if<std::int64_t>(&data)) { return *i; }
+      if (const auto* d = std::get_if<double>(&data))       { return static_cast<std::int64_t>(*d); }
+      return 0;
+    }
+
+    [[nodiscard]]
+    auto as_array() const -> const Array&
+    {
+      static const auto empty = Array{};
+      const auto* a = std::get_if<Array>(&data);
+      return a ? *a : empty;
+    }
+  };
+
+  namespace detail
+  {
+
+    // Arrays and objects nested deeper than this are refused, so a hostile
+    // message cannot run the recursive descent out of stack.
+    constexpr auto max_depth = std::size_t{256};
+
+    // What a lone or mismatched surrogate escape decodes to.
+    constexpr auto replacement = std::uint32_t{0xFFFD};
+
+    class Parser
+    {
+    public:
+      explicit Parser(std::string_view text) : text_{text} {}
+
+      auto document() -> std::expected<Value, std::string>
+      {
+        auto value = parse_value();
+        skip_whitespace();
+        if (value and pos_ != text_.size())
+        {
+          return fail("trailing characters");
+        }
+        return value;
+      }
+
+    private:
+      auto fail(std::string_view what) const -> std::unexpected<std::string>
+      {
+        return std::unexpected(std::format("json: {} at offset {}", what, pos_));
+      }
+
+      void skip_whitespace()
+      {
+        while (pos_ < text_.size() and std::string_view{" \t\r\n"}.contains(text_[pos_]))
+        {
+          ++pos_;
+        }
+      }
+
+      auto consume(std::string_view word) -> bool
+      {
+        if (text_.substr(pos_).starts_with(word))
+        {
+          pos_ += word.size();
+          return true;
+        }
+        return false;
+      }
+
+      auto parse_value() -> std::expected<Value, std::string>
+      {
+        skip_whitespace();
+        if (pos_ >= text_.size())
+        {
+          return fail("unexpected end of input");
+        }
+
+        switch (text_[pos_])
+        {
+          case '{':
+          case '[':
+          {
+            if (depth_ == max_depth)
+            {
+              return fail("nested too deeply");
+            }
+            ++depth_;
+            auto value = text_[pos_] == '{' ? parse_object() : parse_array();
+            --depth_;
+            return value;
+          }
+          case '"':
+          {
+            auto s = parse_string();
+            if (not s) { return std::unexpected(s.error()); }
+            return Value{std::move(*s)};
+          }
+          default: break;
+        }
+
+        if (consume("true"))  { return Value{true};    }
+        if (consume("false")) { return Value{false};   }
+        if (consume("null"))  { return Value{nullptr}; }
+
+        return parse_number();
+      }
+
+      auto parse_number() -> std::expected<Value, std::string>
+      {
+        const auto start = pos_;
+        auto is_float = false;
+        while (pos_ < text_.size() and std::string_view{"+-0123456789.eE"}.contains(text_[pos_]))
+        {
+          is_float = is_float or std::string_view{".eE"}.contains(text_[pos_]);
+          ++pos_;
+        }
+
+        const auto* first = text_.data() + start;
+        const auto* last  = text_.data() + pos_;
+        if (is_float)
+        {
+          auto d = double{};
+          if (std::from_chars(first, last, d).ptr == last) { return Value{d}; }
+        }
+        else
+        {
+          auto i = std::int64_t{};
+          if (std::from_chars(first, last, i).ptr == last and first != last) { return Value{i}; }
+        }
+        return fail("invalid value");
+      }
+
+      auto parse_hex4() -> std::expected<std::uint32_t, std::string>
+      {
+        auto code = std::uint32_t{};
+        const auto* first = text_.data() + pos_;
+        if (text_.size() - pos_ < 4 or std::from_chars(first, first + 4, code, 16).ptr != first + 4)
+        {
+          return fail("invalid \\u escape");
+        }
+        pos_ += 4;
+        return code;
+      }
+
+      static void append_utf8(std::string& out, std::uint32_t code)
+      {
+        if (code < 0x80)
+        {
+          out += static_cast<char>(code);
+        }
+        else if (code < 0x800)
+        {
+          out += static_cast<char>(0xC0 | (code >> 6));
+          out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else if (code < 0x10000)
+        {
+          out += static_cast<char>(0xE0 | (code >> 12));
+          out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+          out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else
+        {
+          out += static_cast<char>(0xF0 | (code >> 18));
+          out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+          out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+          out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+      }
+
+      auto parse_string() -> std::expected<std::string, std::string>
+      {
+        ++pos_; // opening quote
+        auto out = std::string{};
+
+        while (pos_ < text_.size())
+        {
+          const auto ch = text_[pos_++];
+          if (ch == '"')
+          {
+            return out;
+          }
+          if (ch != '\\')
+          {
+            out += ch;
+            continue;
+          }
+          if (pos_ >= text_.size())
+          {
+            break;
+          }
+
+          switch (const auto esc = text_[pos_++]; esc)
+          {
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u':
+            {
+              auto code = parse_hex4();
+              if (not code) { return std::unexpected(code.error()); }
+
+              if (*code >= 0xD800 and *code < 0xDC00)
+              {
+                // Only a low surrogate completes the pair; anything else is
+                // left in place to be read as what it is.
+                const auto high = *code;
+                const auto mark = pos_;
+                auto       low  = consume("\\u") ? parse_hex4() : std::unexpected(std::string{});
+
+                if (low and *low >= 0xDC00 and *low < 0xE000)
+                {
+                  *code = 0x10000 + ((high - 0xD800) << 10) + (*low - 0xDC00);
+                }
+                else
+                {
+                  pos_  = mark;
+                  *code = replacement;
+                }
+              }
+              else if (*code >= 0xDC00 and *code < 0xE000)
+              {
+                *code = replacement;
+              }
+              append_utf8(out, *code);
+              break;
+            }
+            default: out += esc; break;
+          }
+        }
+        return fail("unterminated string");
+      }
+
+      auto parse_array() -> std::expected<Value, std::string>
+      {
+        ++pos_;
+        auto array = Array{};
+
+        skip_whitespace();
+        if (consume("]"))
+        {
+          return Value{std::move(array)};
+        }
+
+        while (true)
+        {
+          auto value = parse_value();
+          if (not value) { return value; }
+          array.push_back(std::move(*value));
+
+          skip_whitespace();
+          if (consume("]")) { return Value{std::move(array)}; }
+          if (not consume(",")) { return fail("expected ',' or ']'"); }
+        }
+      }
+
+      auto parse_object() -> std::expected<Value, std::string>
+      {
+        ++pos_;
+        auto object = Object{};
+
+        skip_whitespace();
+        if (consume("}"))
+        {
+          return Value{std::move(object)};
+        }
+
+        while (true)
+        {
+          skip_whitespace();
+          if (pos_ >= text_.size() or text_[pos_] != '"')
+          {
+            return fail("expected key");
+          }
+
+          auto key = parse_string();
+          if (not key) { return std::unexpected(key.error()); }
+
+          skip_whitespace();
+          if (not consume(":")) { return fail("expected ':'"); }
+
+          auto value = parse_value();
+          if (not value) { return value; }
+          object.emplace_back(std::move(*key), std::move(*value));
+
+          skip_whitespace();
+          if (consume("}")) { return Value{std::move(object)}; }
+          if (not consume(",")) { return fail("expected ',' or '}'"); }
+        }
+      }
+
+      std::string_view text_;
+      std::size_t      pos_   = 0;
+      std::size_t      depth_ = 0;
+    };
+
+    inline void dump_string(std::string& out, std::string_view s)
+    {
+      out += '"';
+      for (const auto ch : s)
+      {
+        switch (ch)
+        {
+          case '"':  out += "\\\""; break;
+          case '\\': out += "\\\\"; break;
+          case '\n': out += "\\n";  break;
+          case '\r': out += "\\r";  break;
+          case '\t': out += "\\t";  break;
+          default:
+            if (static_cast<unsigned char>(ch) < 0x20)
+            {
+              std::format_to(std::back_inserter(out), "\\u{:04x}", static_cast<unsigned>(ch));
+            }
+            else
+            {
+              out += ch;
+            }
+            break;
+        }
+      }
+      out += '"';
+    }
+
+    inline void dump(std::string& out, const Value& value)
+    {
+      std::visit
+      (
+        tks::overload
+        {
+          [&](std::nullptr_t)        { out += "null"; },
+          [&](bool b)                { out += b ? "true" : "false"; },
+          [&](std::int64_t i)        { std::format_to(std::back_inserter(out), "{}", i); },
+          [&](double d)              { std::format_to(std::back_inserter(out), "{}", d); },
+          [&](const std::string& s)  { dump_string(out, s); },
+          [&](const Array& array)
+          {
+            out += '[';
+            for (auto first = true; const auto& item : array)
+            {
+              if (not std::exchange(first, false)) { out += ','; }
+              dump(out, item);
+            }
+            out += ']';
+          },
+          [&](const Object& object)
+          {
+            out += '{';
+            for (auto first = true; const auto& [key, item] : object)
+            {
+              if (not std::exchange(first, false)) { out += ','; }
+              dump_string(out, key);
+              out += ':';
+              dump(out, item);
+            }
+            out += '}';
+          }
+        }, value.data
+      );
+    }
+
+  }
+
+  inline auto parse(std::string_view text) -> std::expected<Value, std::string>
+  {
+    return detail::Parser{text}.document();
+  }
+
+  inline auto dump(const Value& value) -> std::string
+  {
+    auto out = std::string{};
+    detail::dump(out, value);
+    return out;
+  }
+
+}
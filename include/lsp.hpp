@@ -0,0 +1,830 @@
+#pragma once
+
+#include "analyzers.hpp"
+#include "constants.hpp"
+#include "diagnostics.hpp"
+#include "json.hpp"
+#include "source.hpp"
+#include "tokens.hpp"
+#include "utf8.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <expected>
+#include <format>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <print>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace lsp
+{
+
+  struct Position
+  {
+    std::uint32_t line;
+    std::uint32_t character;
+  };
+
+  // How `character` counts within a line on the wire; UTF-16 code units are
+  // the protocol default, the documents themselves are indexed by byte.
+  enum struct Encoding { Utf8, Utf16 };
+
+  // Semantic token legend, indices are what goes on the wire.
+  enum struct TokenType : std::uint32_t { Keyword, Type, Number, Variable, Function, Operator };
+
+  constexpr auto token_legend = std::array{"keyword", "type", "number", "variable", "function", "operator"};
+
+  [[nodiscard]]
+  constexpr auto token_type(const Token& token) -> std::optional<TokenType>
+  {
+    return std::visit
+    (
+      tks::overload
+      {
+        [](tks::If)      { return std::optional{TokenType::Keyword}; },
+        [](tks::Else)    { return std::optional{TokenType::Keyword}; },
+        [](tks::For)     { return std::optional{TokenType::Keyword}; },
+        [](tks::Elif)    { return std::optional{TokenType::Keyword}; },
+        [](tks::Proc)    { return std::optional{TokenType::Keyword}; },
+        [](tks::Var)     { return std::optional{TokenType::Keyword}; },
+        [](tks::Run)     { return std::optional{TokenType::Keyword}; },
+        [](tks::Return)  { return std::optional{TokenType::Keyword}; },
+        [](tks::True)    { return std::optional{TokenType::Keyword}; },
+        [](tks::False)   { return std::optional{TokenType::Keyword}; },
+
+        [](tks::Int)     { return std::optional{TokenType::Type};    },
+        [](tks::Float)   { return std::optional{TokenType::Type};    },
+        [](tks::Bool)    { return std::optional{TokenType::Type};    },
+
+        [](tks::IntNum)   { return std::optional{TokenType::Number}; },
+        [](tks::FloatNum) { return std::optional{TokenType::Number}; },
+
+        [](tks::Id)      { return std::optional{TokenType::Variable}; },
+
+        [](tks::Assign)  { return std::optional{TokenType::Operator}; },
+        [](tks::Plus)    { return std::optional{TokenType::Operator}; },
+        [](tks::Minus)   { return std::optional{TokenType::Operator}; },
+        [](tks::Mul)     { return std::optional{TokenType::Operator}; },
+        [](tks::Devide)  { return std::optional{TokenType::Operator}; },
+        [](tks::Equal)   { return std::optional{TokenType::Operator}; },
+        [](tks::Unequal) { return std::optional{TokenType::Operator}; },
+        [](tks::GrEqual) { return std::optional{TokenType::Operator}; },
+        [](tks::LeEqual) { return std::optional{TokenType::Operator}; },
+        [](tks::Greater) { return std::optional{TokenType::Operator}; },
+        [](tks::Less)    { return std::optional{TokenType::Operator}; },
+
+        [](auto)         { return std::optional<TokenType>{};         }
+      }, token
+    );
+  }
+
+  // One open text document. Lexemes never cross a newline, so every line is
+  // lexed on its own and an edit only re-lexes the lines it touches; token
+  // spans are relative to the start of their line. Each document interns
+  // into its own identifier table and constants pool, so symbol numbers stay
+  // stable across edits and suggestions only come from this document. Names
+  // and literals an edit removes stay until the next full sync.
+  class Document
+  {
+  public:
+    struct Line
+    {
+      std::string                  text;
+      std::vector<tks::Spanned>    tokens;
+      std::vector<diag::Diagnostic> diagnostics;
+    };
+
+    explicit Document(std::string_view text)
+    {
+      replace({0, 0}, {0, 0}, text);
+    }
+
+    [[nodiscard]]
+    auto lines() const -> const std::vector<Line>&
+    {
+      return lines_;
+    }
+
+    void replace_all(std::string_view text)
+    {
+      lines_.clear();
+      identifiers_->clear();
+      literals_ = std::make_unique<constants::Pool>();
+      replace({0, 0}, {0, 0}, text);
+    }
+
+    // Applies an incremental change; positions are clamped to the document.
+    void replace(Position start, Position end, std::string_view text)
+    {
+      auto scope = analyzer::IdentifierScope{*identifiers_};
+      auto lent  = constants::PoolScope{*literals_};
+
+      if (lines_.empty())
+      {
+        lines_.push_back(analyze(""));
+      }
+
+      start = clamp(start);
+      end   = clamp(end);
+      if (end.line < start.line or (end.line == start.line and end.character < start.character))
+      {
+        std::swap(start, end);
+      }
+
+      auto edited = lines_[start.line].text.substr(0, start.character);
+      edited += text;
+      edited += std::string_view{lines_[end.line].text}.substr(end.character);
+
+      auto fresh = std::vector<Line>{};
+      for (auto piece : stdv::split(std::string_view{edited}, '\n'))
+      {
+        fresh.push_back(analyze(std::string_view{piece.begin(), piece.end()}));
+      }
+
+      auto first = lines_.begin() + start.line;
+      auto last  = lines_.begin() + end.line + 1;
+      lines_.insert(lines_.erase(first, last), std::make_move_iterator(fresh.begin()), std::make_move_iterator(fresh.end()));
+    }
+
+    [[nodiscard]]
+    auto token_at(Position position) const -> const tks::Spanned*
+    {
+      if (position.line >= lines_.size())
+      {
+        return nullptr;
+      }
+
+      for (const auto& token : lines_[position.line].tokens)
+      {
+        if (token.span.offset <= position.character and position.character <= token.span.offset + token.span.length)
+        {
+          return &token;
+        }
+      }
+      return nullptr;
+    }
+
+    struct Definition
+    {
+      Position     position;
+      tks::Span    span;
+      bool         is_proc;
+      std::string  type;
+    };
+
+    // Declaration sites are `proc _x`, `var _x` and `_x : type` (parameters
+    // and typed variables); the first one in the document wins.
+    [[nodiscard]]
+    auto definition(std::size_t symbol) const -> std::optional<Definition>
+    {
+      const Token* previous = nullptr;
+
+      for (auto line : range(0uz, lines_.size()))
+      {
+        const auto& tokens = lines_[line].tokens;
+
+        for (auto index : range(0uz, tokens.size()))
+        {
+          const auto& [token, span] = tokens[index];
+          const auto* id = std::get_if<tks::Id>(&token);
+
+          if (id and id->symbol == symbol)
+          {
+            const auto after_proc   = previous and std::holds_alternative<tks::Proc>(*previous);
+            const auto after_var    = previous and std::holds_alternative<tks::Var>(*previous);
+            const auto before_colon = index + 1 < tokens.size() and std::holds_alternative<tks::Colon>(tokens[index + 1].token);
+
+            if (after_proc or after_var or before_colon)
+            {
+              auto type = std::string{after_proc ? "proc" : "var"};
+              if (before_colon and index + 2 < tokens.size())
+              {
+                type = type_name(tokens[index + 2].token);
+              }
+
+              return Definition
+              {
+                .position = {static_cast<std::uint32_t>(line), span.offset},
+                .span     = span,
+                .is_proc  = after_proc,
+                .type     = std::move(type)
+              };
+            }
+          }
+
+          previous = &token;
+        }
+      }
+
+      return std::nullopt;
+    }
+
+    // Symbols introduced by `proc`, collected in one pass for semantic tokens.
+    [[nodiscard]]
+    auto procs() const -> std::unordered_set<std::size_t>
+    {
+      auto result   = std::unordered_set<std::size_t>{};
+      auto previous = false;
+
+      for (const auto& line : lines_)
+      {
+        for (const auto& [token, span] : line.tokens)
+        {
+          if (const auto* id = std::get_if<tks::Id>(&token); id and previous)
+          {
+            result.insert(id->symbol);
+          }
+          previous = std::holds_alternative<tks::Proc>(token);
+        }
+      }
+      return result;
+    }
+
+  private:
+    static auto type_name(const Token& token) -> std::string
+    {
+      if (std::holds_alternative<tks::Int>(token))   { return "int";   }
+      if (std::holds_alternative<tks::Float>(token)) { return "float"; }
+      if (std::holds_alternative<tks::Bool>(token))  { return "bool";  }
+      return "var";
+    }
+
+    static auto analyze(std::string_view text) -> Line
+    {
+      auto line = Line{.text = std::string{text}, .tokens = {}, .diagnostics = {}};
+
+      // CRLF files keep the '\r' in the text but it is not part of any lexeme.
+      if (text.ends_with('\r'))
+      {
+        text.remove_suffix(1);
+      }
+
+      const auto index = src::LineIndex{text};
+      auto diagnostics = diag::Sink{text.size(), index};
+
+      line.tokens      = analyzer::lex(text, diagnostics);
+      line.diagnostics = diagnostics.entries();
+      return line;
+    }
+
+    auto clamp(Position position) const -> Position
+    {
+      position.line      = std::min<std::uint32_t>(position.line, static_cast<std::uint32_t>(lines_.size() - 1));
+      position.character = std::min<std::uint32_t>(position.character, static_cast<std::uint32_t>(lines_[position.line].text.size()));
+      return position;
+    }
+
+    std::vector<Line>                      lines_;
+    std::unique_ptr<analyzer::Identifiers> identifiers_ = std::make_unique<analyzer::Identifiers>();
+    std::unique_ptr<constants::Pool>       literals_    = std::make_unique<constants::Pool>();
+  };
+
+  namespace detail
+  {
+
+    inline auto position(const json::Value* value) -> Position
+    {
+      if (not value)
+      {
+        return {0, 0};
+      }
+
+      const auto* line      = value->find("line");
+      const auto* character = value->find("character");
+      return
+      {
+        .line      = static_cast<std::uint32_t>(line ? line->as_int() : 0),
+        .character = static_cast<std::uint32_t>(character ? character->as_int() : 0)
+      };
+    }
+
+    // Byte offset of the UTF-16 code unit offset `units` into `text`. A byte
+    // that is not part of a well-formed sequence counts as one unit, as the
+    // U+FFFD an editor shows in its place.
+    inline auto utf16_to_byte(std::string_view text, std::uint32_t units) -> std::uint32_t
+    {
+      auto index = std::size_t{0};
+      for (auto counted = std::uint32_t{0}; counted < units and index < text.size(); )
+      {
+        const auto code = utf8::decode(text, index);
+        if (not code)
+        {
+          ++index;
+        }
+        counted += code and *code > 0xFFFF ? 2 : 1;
+      }
+      return static_cast<std::uint32_t>(index);
+    }
+
+    inline auto byte_to_utf16(std::string_view text, std::uint32_t offset) -> std::uint32_t
+    {
+      auto units = std::uint32_t{0};
+      for (auto index = std::size_t{0}; index < offset and index < text.size(); )
+      {
+        const auto code = utf8::decode(text, index);
+        if (not code)
+        {
+          ++index;
+        }
+        units += code and *code > 0xFFFF ? 2 : 1;
+      }
+      return units;
+    }
+
+    inline auto to_json(Position position) -> json::Value
+    {
+      return json::Object{{"line", position.line}, {"character", position.character}};
+    }
+
+    inline auto to_json(std::uint32_t line, tks::Span span) -> json::Value
+    {
+      return json::Object
+      {
+        {"start", to_json({line, span.offset})},
+        {"end",   to_json({line, span.offset + span.length})}
+      };
+    }
+
+    // Bodies above this are skipped unread rather than allocated.
+    constexpr auto max_message = std::size_t{64} << 20;
+
+    // Reads one `Content-Length` framed message: its body, or why it was
+    // dropped. Nothing means end of input, or a header without a usable
+    // length, after which the framing cannot be trusted.
+    inline auto read_message(std::istream& in) -> std::optional<std::expected<std::string, std::string>>
+    {
+      auto length = std::optional<std::size_t>{};
+      auto header = std::string{};
+
+      while (std::getline(in, header))
+      {
+        if (header.ends_with('\r'))
+        {
+          header.pop_back();
+        }
+        if (header.empty())
+        {
+          break;
+        }
+
+        constexpr auto key = std::string_view{"Content-Length:"};
+        if (header.starts_with(key))
+        {
+          auto value = std::string_view{header}.substr(key.size());
+          while (value.starts_with(' '))
+          {
+            value.remove_prefix(1);
+          }
+
+          auto parsed = std::size_t{};
+          if (const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), parsed); ec != std::errc{} or end != value.data() + value.size())
+          {
+            return std::nullopt;
+          }
+          length = parsed;
+        }
+      }
+
+      if (not in or not length)
+      {
+        return std::nullopt;
+      }
+
+      if (*length > max_message)
+      {
+        in.ignore(static_cast<std::streamsize>(std::min<std::size_t>(*length, std::numeric_limits<std::streamsize>::max())));
+        return std::unexpected{std::format("message of {} bytes is over the {} MiB limit", *length, max_message >> 20)};
+      }
+
+      auto body = std::string(*length, '\0');
+      in.read(body.data(), static_cast<std::streamsize>(*length));
+      if (not in)
+      {
+        return std::nullopt;
+      }
+      return body;
+    }
+
+    inline void write_message(std::ostream& out, const json::Value& message)
+    {
+      const auto body = json::dump(message);
+      std::print(out, "Content-Length: {}\r\n\r\n{}", body.size(), body);
+      out.flush();
+    }
+
+  }
+
+  // Language server over stdio. Positions are byte offsets into a line, which
+  // is what the lexer works with, so UTF-8 is used whenever the client offers
+  // it; otherwise columns are converted to and from UTF-16 at the boundary.
+  class Server
+  {
+  public:
+    Server(std::istream& in, std::ostream& out) : in_{in}, out_{out} {}
+
+    auto run() -> int
+    {
+      while (auto body = detail::read_message(in_))
+      {
+        if (not *body)
+        {
+          respond_error(json::Value{}, -32600, body->error());
+          continue;
+        }
+
+        auto message = json::parse(**body);
+        if (not message)
+        {
+          respond_error(json::Value{}, -32700, message.error());
+          continue;
+        }
+
+        const auto  method = message->find("method") ? message->find("method")->as_string() : std::string_view{};
+        const auto* id     = message->find("id");
+        const auto* params = message->find("params");
+        const auto  empty  = json::Value{json::Object{}};
+
+        if (method == "exit")
+        {
+          return shutdown_ ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        auto result = handle(method, params ? *params : empty);
+
+        if (id)
+        {
+          if (result)
+          {
+            respond(*id, std::move(*result));
+          }
+          else
+          {
+            respond_error(*id, -32601, std::format("unhandled method \"{}\"", method));
+          }
+        }
+      }
+
+      return shutdown_ ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+  private:
+    auto handle(std::string_view method, const json::Value& params) -> std::optional<json::Value>
+    {
+      if (method == "initialize")                       { return initialize(params); }
+      if (method == "shutdown")                         { shutdown_ = true; return json::Value{}; }
+      if (method == "textDocument/didOpen")             { did_open(params);   return json::Value{}; }
+      if (method == "textDocument/didChange")           { did_change(params); return json::Value{}; }
+      if (method == "textDocument/didClose")            { did_close(params);  return json::Value{}; }
+      if (method == "textDocument/semanticTokens/full") { return semantic_tokens(params); }
+      if (method == "textDocument/definition")          { return definition(params); }
+      if (method == "textDocument/hover")               { return hover(params); }
+      if (method == "textDocument/codeAction")          { return code_actions(params); }
+      if (method == "initialized" or method.starts_with("$/"))
+      {
+        return json::Value{};
+      }
+      return std::nullopt;
+    }
+
+    auto initialize(const json::Value& params) -> json::Value
+    {
+      encoding_ = Encoding::Utf16;
+      if (const auto* offered = params.at("capabilities", "general", "positionEncodings"))
+      {
+        const auto& encodings = offered->as_array();
+        if (std::ranges::find(encodings, std::string_view{"utf-8"}, &json::Value::as_string) != encodings.end())
+        {
+          encoding_ = Encoding::Utf8;
+        }
+      }
+
+      auto legend = json::Array{};
+      for (const auto* type : token_legend)
+      {
+        legend.emplace_back(type);
+      }
+
+      return json::Object
+      {
+        {"capabilities", json::Object
+          {
+            {"positionEncoding", encoding_ == Encoding::Utf8 ? "utf-8" : "utf-16"},
+            {"textDocumentSync", json::Object{{"openClose", true}, {"change", 2}}},
+            {"semanticTokensProvider", json::Object
+              {
+                {"legend", json::Object{{"tokenTypes", std::move(legend)}, {"tokenModifiers", json::Array{}}}},
+                {"full", true}
+              }
+            },
+            {"definitionProvider", true},
+            {"hoverProvider", true},
+            {"codeActionProvider", true}
+          }
+        },
+        {"serverInfo", json::Object{{"name", "compiler-404"}}}
+      };
+    }
+
+    auto document(const json::Value& params) -> Document*
+    {
+      const auto* uri = params.at("textDocument", "uri");
+      if (not uri)
+      {
+        return nullptr;
+      }
+
+      auto it = documents_.find(std::string{uri->as_string()});
+      return it == documents_.end() ? nullptr : &it->second;
+    }
+
+    void did_open(const json::Value& params)
+    {
+      const auto* uri  = params.at("textDocument", "uri");
+      const auto* text = params.at("textDocument", "text");
+      if (not uri or not text)
+      {
+        return;
+      }
+
+      auto key = std::string{uri->as_string()};
+      documents_.insert_or_assign(key, Document{text->as_string()});
+      publish_diagnostics(key);
+    }
+
+    void did_change(const json::Value& params)
+    {
+      auto* doc = document(params);
+      const auto* changes = params.find("contentChanges");
+      if (not doc or not changes)
+      {
+        return;
+      }
+
+      for (const auto& change : changes->as_array())
+      {
+        const auto* text  = change.find("text");
+        const auto* range = change.find("range");
+        if (not text)
+        {
+          continue;
+        }
+
+        if (range)
+        {
+          const auto start = from_wire(*doc, detail::position(range->find("start")));
+          const auto end   = from_wire(*doc, detail::position(range->find("end")));
+          doc->replace(start, end, text->as_string());
+        }
+        else
+        {
+          doc->replace_all(text->as_string());
+        }
+      }
+
+      publish_diagnostics(std::string{params.at("textDocument", "uri")->as_string()});
+    }
+
+    void did_close(const json::Value& params)
+    {
+      if (const auto* uri = params.at("textDocument", "uri"))
+      {
+        documents_.erase(std::string{uri->as_string()});
+      }
+    }
+
+    void publish_diagnostics(const std::string& uri)
+    {
+      const auto& doc = documents_.at(uri);
+
+      auto list = json::Array{};
+      for (auto line : range(0uz, doc.lines().size()))
+      {
+        for (const auto& diagnostic : doc.lines()[line].diagnostics)
+        {
+          auto message = diag::describe(diagnostic);
+          if (not diagnostic.suggestion.empty())
+          {
+            message += std::format(" Did you mean \"{}\"?", diagnostic.suggestion);
+          }
+
+          list.emplace_back(json::Object
+          {
+            {"range",    detail::to_json(static_cast<std::uint32_t>(line), to_wire(doc, line, diagnostic.span))},
+            {"severity", 1},
+            {"source",   "compiler-404"},
+            {"message",  std::move(message)}
+          });
+        }
+      }
+
+      detail::write_message(out_, json::Object
+      {
+        {"jsonrpc", "2.0"},
+        {"method",  "textDocument/publishDiagnostics"},
+        {"params",  json::Object{{"uri", uri}, {"diagnostics", std::move(list)}}}
+      });
+    }
+
+    auto semantic_tokens(const json::Value& params) -> json::Value
+    {
+      const auto* doc = document(params);
+      if (not doc)
+      {
+        return json::Value{};
+      }
+
+      const auto procs = doc->procs();
+
+      auto data      = json::Array{};
+      auto last_line = std::uint32_t{0};
+      auto last_col  = std::uint32_t{0};
+
+      for (auto line : range(0u, static_cast<std::uint32_t>(doc->lines().size())))
+      {
+        for (const auto& [token, bytes] : doc->lines()[line].tokens)
+        {
+          auto type = token_type(token);
+          if (not type)
+          {
+            continue;
+          }
+
+          if (const auto* id = std::get_if<tks::Id>(&token); id and procs.contains(id->symbol))
+          {
+            type = TokenType::Function;
+          }
+
+          const auto span = to_wire(*doc, line, bytes);
+
+          data.emplace_back(line - last_line);
+          data.emplace_back(line == last_line ? span.offset - last_col : span.offset);
+          data.emplace_back(span.length);
+          data.emplace_back(std::to_underlying(*type));
+          data.emplace_back(0);
+
+          last_line = line;
+          last_col  = span.offset;
+        }
+      }
+
+      return json::Object{{"data", std::move(data)}};
+    }
+
+    auto symbol_at(const Document& doc, const json::Value& params) const -> std::optional<std::size_t>
+    {
+      const auto* token = doc.token_at(from_wire(doc, detail::position(params.find("position"))));
+      if (not token)
+      {
+        return std::nullopt;
+      }
+
+      const auto* id = std::get_if<tks::Id>(&token->token);
+      return id ? std::optional{id->symbol} : std::nullopt;
+    }
+
+    auto definition(const json::Value& params) -> json::Value
+    {
+      const auto* doc = document(params);
+      if (not doc)
+      {
+        return json::Value{};
+      }
+
+      const auto symbol = symbol_at(*doc, params);
+      const auto def    = symbol ? doc->definition(*symbol) : std::nullopt;
+      if (not def)
+      {
+        return json::Value{};
+      }
+
+      return json::Object
+      {
+        {"uri",   params.at("textDocument", "uri")->as_string()},
+        {"range", detail::to_json(def->position.line, to_wire(*doc, def->position.line, def->span))}
+      };
+    }
+
+    auto hover(const json::Value& params) -> json::Value
+    {
+      const auto* doc = document(params);
+      if (not doc)
+      {
+        return json::Value{};
+      }
+
+      const auto symbol = symbol_at(*doc, params);
+      const auto def    = symbol ? doc->definition(*symbol) : std::nullopt;
+      if (not def)
+      {
+        return json::Value{};
+      }
+
+      const auto& text = doc->lines()[def->position.line].text;
+      const auto  name = std::string_view{text}.substr(def->span.offset, def->span.length);
+
+      return json::Object
+      {
+        {"contents", json::Object
+          {
+            {"kind",  "markdown"},
+            {"value", def->is_proc ? std::format("```\nproc {}\n```", name) : std::format("```\n{} : {}\n```", name, def->type)}
+          }
+        }
+      };
+    }
+
+    // Offers the "Did you mean" suggestion of every diagnostic in range as a quick fix.
+    auto code_actions(const json::Value& params) -> json::Value
+    {
+      const auto* doc = document(params);
+      if (not doc)
+      {
+        return json::Array{};
+      }
+
+      const auto  uri   = params.at("textDocument", "uri")->as_string();
+      const auto  first = detail::position(params.at("range", "start")).line;
+      const auto  last  = detail::position(params.at("range", "end")).line;
+
+      auto actions = json::Array{};
+      for (auto line = first; line <= last and line < doc->lines().size(); ++line)
+      {
+        for (const auto& [span, lexeme, suggestion, fault] : doc->lines()[line].diagnostics)
+        {
+          if (suggestion.empty())
+          {
+            continue;
+          }
+
+          auto edit = json::Object{{"range", detail::to_json(line, to_wire(*doc, line, span))}, {"newText", suggestion}};
+
+          actions.emplace_back(json::Object
+          {
+            {"title", std::format("Replace \"{}\" with \"{}\"", lexeme, suggestion)},
+            {"kind",  "quickfix"},
+            {"edit",  json::Object{{"changes", json::Object{{std::string{uri}, json::Array{std::move(edit)}}}}}}
+          });
+        }
+      }
+      return actions;
+    }
+
+    // Byte columns of the document to columns in the negotiated encoding and back.
+    auto to_wire(const Document& doc, std::size_t line, tks::Span span) const -> tks::Span
+    {
+      if (encoding_ == Encoding::Utf8)
+      {
+        return span;
+      }
+
+      const auto& text  = doc.lines()[line].text;
+      const auto  start = detail::byte_to_utf16(text, span.offset);
+      return {.offset = start, .length = detail::byte_to_utf16(text, span.offset + span.length) - start};
+    }
+
+    auto from_wire(const Document& doc, Position position) const -> Position
+    {
+      if (encoding_ == Encoding::Utf8 or position.line >= doc.lines().size())
+      {
+        return position;
+      }
+
+      position.character = detail::utf16_to_byte(doc.lines()[position.line].text, position.character);
+      return position;
+    }
+
+    void respond(const json::Value& id, json::Value result)
+    {
+      detail::write_message(out_, json::Object{{"jsonrpc", "2.0"}, {"id", id}, {"result", std::move(result)}});
+    }
+
+    void respond_error(const json::Value& id, int code, std::string message)
+    {
+      detail::write_message(out_, json::Object
+      {
+        {"jsonrpc", "2.0"},
+        {"id",      id},
+        {"error",   json::Object{{"code", code}, {"message", std::move(message)}}}
+      });
+    }
+
+    std::istream&                             in_;
+    std::ostream&                             out_;
+    std::unordered_map<std::string, Document> documents_;
+    Encoding                                  encoding_ = Encoding::Utf16;
+    bool                                      shutdown_ = false;
+  };
+
+}
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <ostream>
+#include <print>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <malloc.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// Heap accounting. main.cpp routes the global operator new/delete through
+// allocate() and release(); until enable() is called they are plain malloc
+// and free. From then on every allocation of the process is counted,
+// whatever container or thread makes it. Sizes are what malloc actually
+// handed out (malloc_usable_size), so frees balance exactly, except for
+// blocks from before enable(): freeing those can take `live` below zero.
+namespace mem
+{
+
+  struct Counters
+  {
+    std::atomic<std::size_t>    allocations = 0;
+    std::atomic<std::ptrdiff_t> live        = 0;
+    std::atomic<std::ptrdiff_t> peak        = 0; // highest `live` since the recording phase began
+    std::atomic<std::ptrdiff_t> limit       = 0; // bytes, 0 means none
+  };
+
+  inline auto counters = Counters{};
+
+  struct PhaseRecord
+  {
+    const char* name;
+    std::size_t allocations;
+    std::size_t high_water;   // peak heap above what was live when the phase began
+    std::size_t retained;     // heap still live at its end, relative to its start
+    std::size_t peak_rss_kib;
+  };
+
+  // Containers that are worth seeing on their own: used vs reserved bytes.
+  struct Usage
+  {
+    const char* name;
+    std::size_t used;
+    std::size_t reserved;
+  };
+
+  class Ledger;
+
+  namespace detail
+  {
+
+    // Per thread, so concurrent compilations do not rename each other's
+    // phases.
+    inline thread_local auto phase  = "setup";
+    inline thread_local auto ledger = static_cast<Ledger*>(nullptr);
+
+    inline auto failing = std::atomic<bool>{false};
+
+    // Written once by enable() before any thread starts, read on every
+    // allocation after that, so a plain bool is enough.
+    inline auto counting = false;
+
+    // Runs inside operator new, so it must not allocate: the message is
+    // built on the stack and written straight to the stdout descriptor.
+    // When several threads cross the limit at once only the first reports,
+    // the others wait for the exit.
+    [[noreturn]]
+    inline void over_limit(std::ptrdiff_t live, std::size_t requested)
+    {
+      if (failing.exchange(true))
+      {
+        while (true)
+        {
+          ::pause();
+        }
+      }
+
+      char message[256];
+      auto* out = message;
+      auto  put = [&](std::string_view text) { out = std::copy(text.begin(), text.end(), out); };
+      auto  num = [&](std::size_t value) { out = std::to_chars(out, message + sizeof(message), value).ptr; };
+
+      put("[Error] memory limit of ");
+      num(static_cast<std::size_t>(counters.limit.load() >> 20));
+      put(" MiB exceeded during ");
+      put(phase);
+      put(" (");
+      num(static_cast<std::size_t>(std::max<std::ptrdiff_t>(live, 0) >> 10));
+      put(" KiB live, ");
+      num(requested);
+      put(" more bytes requested).\n");
+
+      std::fflush(stdout);
+      [[maybe_unused]] auto written = ::write(STDOUT_FILENO, message, static_cast<std::size_t>(out - message));
+      std::_Exit(EXIT_FAILURE);
+    }
+
+    // Every thread's allocations count, so a phase that hands its work to
+    // --jobs workers or the --pipeline lexer still sees their heap. Only a
+    // new high costs a compare-exchange.
+    inline void raise_peak(std::ptrdiff_t live)
+    {
+      auto peak = counters.peak.load(std::memory_order_relaxed);
+      while (live > peak and not counters.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+      {
+      }
+    }
+
+    inline auto account(void* pointer, std::size_t requested) -> void*
+    {
+      if (pointer == nullptr)
+      {
+        return nullptr;
+      }
+
+      const auto bytes = static_cast<std::ptrdiff_t>(::malloc_usable_size(pointer));
+      const auto live  = counters.live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+      counters.allocations.fetch_add(1, std::memory_order_relaxed);
+      raise_peak(live);
+
+      if (const auto limit = counters.limit.load(std::memory_order_relaxed); limit != 0 and live > limit)
+      {
+        over_limit(live - bytes, requested);
+      }
+      return pointer;
+    }
+
+  }
+
+  inline auto allocate(std::size_t size) noexcept -> void*
+  {
+    auto* pointer = std::malloc(std::max<std::size_t>(size, 1));
+    return detail::counting ? detail::account(pointer, size) : pointer;
+  }
+
+  inline auto allocate(std::size_t size, std::align_val_t alignment) noexcept -> void*
+  {
+    const auto align = static_cast<std::size_t>(alignment);
+    auto* pointer = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align);
+    return detail::counting ? detail::account(pointer, size) : pointer;
+  }
+
+  inline void release(void* pointer) noexcept
+  {
+    if (detail::counting and pointer != nullptr)
+    {
+      counters.live.fetch_sub(static_cast<std::ptrdiff_t>(::malloc_usable_size(pointer)), std::memory_order_relaxed);
+    }
+    std::free(pointer);
+  }
+
+  // Starts counting, with a limit in MiB or 0 for none. Only called for
+  // --mem-report and --mem-limit, and before any other thread exists.
+  // parse_options keeps the limit within PTRDIFF_MAX >> 20, so the shift
+  // cannot wrap.
+  inline void enable(std::size_t mebibytes)
+  {
+    counters.limit   = static_cast<std::ptrdiff_t>(mebibytes << 20);
+    detail::counting = true;
+  }
+
+  [[nodiscard]]
+  inline auto peak_rss_kib() -> std::size_t
+  {
+    auto usage = rusage{};
+    ::getrusage(RUSAGE_SELF, &usage);
+    return static_cast<std::size_t>(usage.ru_maxrss);
+  }
+
+  // The phases and container usages of one compilation, recorded on the
+  // thread that created it for as long as it lives. main creates one only
+  // for a one-shot --mem-report run; everywhere else nothing is recorded.
+  class Ledger
+  {
+  public:
+    Ledger()
+      : previous_{std::exchange(detail::ledger, this)}
+    {
+    }
+
+    Ledger(const Ledger&)            = delete;
+    Ledger& operator=(const Ledger&) = delete;
+
+    ~Ledger()
+    {
+      detail::ledger = previous_;
+    }
+
+  private:
+    friend class Phase;
+    friend void note(Usage usage);
+    friend void report(std::ostream& out);
+
+    std::vector<PhaseRecord> phases_;
+    std::vector<Usage>       usages_;
+    Ledger*                  previous_;
+  };
+
+  // Whether note() and Phase keep anything; lets callers skip measuring.
+  [[nodiscard]]
+  inline auto recording() -> bool
+  {
+    return detail::ledger != nullptr;
+  }
+
+  inline void note(Usage usage)
+  {
+    if (detail::ledger != nullptr)
+    {
+      detail::ledger->usages_.push_back(usage);
+    }
+  }
+
+  // Names this thread's allocations until it goes out of scope, for the
+  // --mem-limit message, and records their count and high-water mark in the
+  // thread's ledger. The high-water mark is the process-wide peak while the
+  // phase lasts; only a one-shot run records, its phases follow each other
+  // on the main thread, so restarting the shared peak is safe there. Does
+  // nothing unless counting is enabled.
+  class Phase
+  {
+  public:
+    explicit Phase(const char* name)
+      : name_{name}
+    {
+      if (detail::counting)
+      {
+        previous_    = std::exchange(detail::phase, name);
+        allocations_ = counters.allocations.load();
+        live_        = counters.live.load();
+
+        if (detail::ledger != nullptr)
+        {
+          previous_peak_ = counters.peak.exchange(live_);
+        }
+      }
+    }
+
+    Phase(const Phase&)            = delete;
+    Phase& operator=(const Phase&) = delete;
+
+    ~Phase()
+    {
+      if (not detail::counting)
+      {
+        return;
+      }
+
+      if (detail::ledger != nullptr)
+      {
+        const auto live = counters.live.load();
+        detail::ledger->phases_.push_back(
+        {
+          .name         = name_,
+          .allocations  = counters.allocations.load() - allocations_,
+          .high_water   = static_cast<std::size_t>(std::max<std::ptrdiff_t>(counters.peak.load() - live_, 0)),
+          .retained     = static_cast<std::size_t>(std::max<std::ptrdiff_t>(live - live_, 0)),
+          .peak_rss_kib = peak_rss_kib()
+        });
+
+        // An enclosing phase keeps the peak it had seen before this one.
+        detail::raise_peak(previous_peak_);
+      }
+      detail::phase = previous_;
+    }
+
+  private:
+    const char*    name_;
+    const char*    previous_      = nullptr;
+    std::size_t    allocations_   = 0;
+    std::ptrdiff_t live_          = 0;
+    std::ptrdiff_t previous_peak_ = 0;
+  };
+
+  // This thread's ledger, if it has one, then the process totals.
+  inline void report(std::ostream& out)
+  {
+    auto kib = [](std::size_t bytes) { return static_cast<double>(bytes) / 1024.0; };
+
+    if (const auto* ledger = detail::ledger; ledger != nullptr)
+    {
+      for (const auto& phase : ledger->phases_)
+      {
+        std::println(out, "[MEM] {:<12} {:>9} allocation(s), high-water {:>10.1f} KiB, retained {:>10.1f} KiB, peak RSS {} KiB",
+                     phase.name, phase.allocations, kib(phase.high_water), kib(phase.retained), phase.peak_rss_kib);
+      }
+      for (const auto& usage : ledger->usages_)
+      {
+        std::println(out, "[MEM] {:<12} {:.1f} KiB used of {:.1f} KiB reserved", usage.name, kib(usage.used), kib(usage.reserved));
+      }
+    }
+    std::println(out, "[MEM] total        {:>9} allocation(s), {:.1f} KiB live, peak RSS {} KiB",
+                 counters.allocations.load(), kib(static_cast<std::size_t>(std::max<std::ptrdiff_t>(counters.live.load(), 0))), peak_rss_kib());
+  }
+
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace cli
+{
+
+  enum struct Query
+  {
+    None,
+    FirstError,
+    CountProcs,
+    TailCalls
+  };
+
+  struct Options
+  {
+    std::filesystem::path input;
+    std::size_t           max_errors  = 20;
+    bool                  interactive = false;
+    bool                  lsp         = false;
+    bool                  pipeline    = false;
+    bool                  prune_procs = false;
+    bool                  mem_report  = false;
+    std::size_t           batch_size    = 1024;
+    std::size_t           ring_capacity = 16;
+    std::size_t           jobs          = 1;
+    std::size_t           mem_limit     = 0;
+    Query                 query         = Query::None;
+    std::filesystem::path server;
+    std::filesystem::path client;
+    std::filesystem::path watch;
+    std::filesystem::path trace;
+  };
+
+  constexpr auto usage =
+    "[--max-errors N] [--prune-procs] [--trace=out.json] [--mem-report] [--mem-limit MiB] [--interactive | --pipeline [--batch-size N] [--ring-capacity N] | --jobs N] code.txt | --query first-error|count-procs|tail-calls code.txt | --lsp"
+    " | --server socket | --client socket code.txt | --watch dir";
+
+  // Far more than any machine this runs on has cores; beyond it --jobs only
+  // costs threads.
+  constexpr auto max_jobs = std::size_t{256};
+
+  namespace detail
+  {
+
+    inline auto parse_count(std::string_view flag, std::string_view value) -> std::expected<std::size_t, std::string>
+    {
+      auto count = std::size_t{};
+      auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), count);
+
+      if (ec != std::errc{} or ptr != value.data() + value.size())
+      {
+        return std::unexpected(std::format("{} expects a number, got \"{}\"", flag, value));
+      }
+
+      return count;
+    }
+
+    // A numeric option: the field it fills and the values that make sense,
+    // so nonsense is refused here rather than as a failed thread spawn or
+    // an overflow later on.
+    struct Count
+    {
+      std::size_t* field;
+      std::size_t  lowest;
+      std::size_t  highest;
+    };
+
+    constexpr auto unbounded = std::numeric_limits<std::size_t>::max();
+
+    // Largest MiB count whose byte value still fits mem::Counters::limit.
+    constexpr auto max_mem_limit = static_cast<std::size_t>(std::numeric_limits<std::ptrdiff_t>::max() >> 20);
+
+    inline auto count_option(std::string_view flag, Options& options) -> std::optional<Count>
+    {
+      if (flag == "--max-errors")    { return Count{&options.max_errors,    0, unbounded};     }
+      if (flag == "--batch-size")    { return Count{&options.batch_size,    1, 1uz << 20};     }
+      if (flag == "--ring-capacity") { return Count{&options.ring_capacity, 1, 1uz << 16};     }
+      if (flag == "--jobs")          { return Count{&options.jobs,          1, max_jobs};      }
+      if (flag == "--mem-limit")     { return Count{&options.mem_limit,     0, max_mem_limit}; }
+      return std::nullopt;
+    }
+
+    // Options taking a path other than the input.
+    inline auto path_option(std::string_view flag, Options& options) -> std::filesystem::path*
+    {
+      if (flag == "--server") { return &options.server; }
+      if (flag == "--client") { return &options.client; }
+      if (flag == "--watch")  { return &options.watch;  }
+      if (flag == "--trace")  { return &options.trace;  }
+      return nullptr;
+    }
+
+  }
+
+  inline auto parse_options(int argc, char** argv) -> std::expected<Options, std::string>
+  {
+    auto options = Options{};
+    auto args    = std::span{argv, static_cast<std::size_t>(argc)}.subspan(1);
+
+    for (auto it = args.begin(); it != args.end(); ++it)
+    {
+      const auto arg = std::string_view{*it};
+
+      if (arg == "--interactive")
+      {
+        options.interactive = true;
+      }
+      else if (arg == "--lsp")
+      {
+        options.lsp = true;
+      }
+      else if (arg == "--pipeline")
+      {
+        options.pipeline = true;
+      }
+      else if (arg == "--prune-procs")
+      {
+        options.prune_procs = true;
+      }
+      else if (arg == "--mem-report")
+      {
+        options.mem_report = true;
+      }
+      else if (arg == "--query")
+      {
+        if (std::next(it) == args.end())
+        {
+          return std::unexpected(std::string{"--query expects a name"});
+        }
+
+        const auto name = std::string_view{*++it};
+        if (name == "first-error")
+        {
+          options.query = Query::FirstError;
+        }
+        else if (name == "count-procs")
+        {
+          options.query = Query::CountProcs;
+        }
+        else if (name == "tail-calls")
+        {
+          options.query = Query::TailCalls;
+        }
+        else
+        {
+          return std::unexpected(std::format("unknown query \"{}\"", name));
+        }
+      }
+      else if (auto count = detail::count_option(arg, options))
+      {
+        if (std::next(it) == args.end())
+        {
+          return std::unexpected(std::format("{} expects a value", arg));
+        }
+
+        auto value = detail::parse_count(arg, *++it);
+        if (not value)
+        {
+          return std::unexpected(value.error());
+        }
+        if (*value < count->lowest or *value > count->highest)
+        {
+          return std::unexpected(std::format("{} expects a value from {} to {}, got {}", arg, count->lowest, count->highest, *value));
+        }
+        *count->field = *value;
+      }
+      else if (arg.starts_with("--trace="))
+      {
+        options.trace = arg.substr(std::string_view{"--trace="}.size());
+      }
+      else if (auto* path = detail::path_option(arg, options))
+      {
+        if (std::next(it) == args.end())
+        {
+          return std::unexpected(std::format("{} expects a path", arg));
+        }
+        *path = *++it;
+      }
+      else if (arg.starts_with("--"))
+      {
+        return std::unexpected(std::format("unknown option \"{}\"", arg));
+      }
+      else if (options.input.empty())
+      {
+        options.input = arg;
+      }
+      else
+      {
+        return std::unexpected(std::string{"only one input file is accepted"});
+      }
+    }
+
+    if (options.pipeline and options.interactive)
+    {
+      return std::unexpected(std::string{"--pipeline cannot prompt, drop --interactive"});
+    }
+
+    if (options.jobs > 1 and (options.pipeline or options.interactive))
+    {
+      return std::unexpected(std::string{"--jobs cannot be combined with --pipeline or --interactive"});
+    }
+
+    if (not options.server.empty() and (options.interactive or not options.client.empty()))
+    {
+      return std::unexpected(std::string{"--server cannot prompt or act as a client"});
+    }
+
+    // The server runs its own pipeline settings and cannot prompt or answer
+    // queries; what a client forwards is --max-errors, --prune-procs, --jobs.
+    if (not options.client.empty() and (options.interactive or options.pipeline or options.query != Query::None))
+    {
+      return std::unexpected(std::string{"--client forwards --max-errors, --prune-procs and --jobs only"});
+    }
+
+    if (not options.watch.empty() and (options.interactive or not options.input.empty()))
+    {
+      return std::unexpected(std::string{"--watch compiles the whole directory and cannot prompt"});
+    }
+
+    // The watcher recompiles through its query database, one file at a time
+    // and without call-graph pruning.
+    if (not options.watch.empty() and (options.prune_procs or options.pipeline or options.jobs > 1))
+    {
+      return std::unexpected(std::string{"--watch cannot be combined with --prune-procs, --pipeline or --jobs"});
+    }
+
+    if (options.input.empty() and not options.lsp and options.server.empty() and options.watch.empty())
+    {
+      return std::unexpected(std::string{"no input file given"});
+    }
+
+    return options;
+  }
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "source.hpp"
+#include "tokens.hpp"
+
+#include <cstdint>
+#include <format>
+#include <ostream>
+#include <variant>
+
+namespace output
+{
+
+  // Writes tokens back onto the source lines they came from, one output line
+  // per input line. Tokens must arrive in source order, which lets the writer
+  // follow the line starts forward instead of searching them.
+  class LineWriter
+  {
+  public:
+    LineWriter(std::ostream& out, const src::LineIndex& lines) : out_{out}, lines_{lines} {}
+
+    void write(const tks::Spanned& token)
+    {
+      while (line_ < lines_.lines() and token.span.offset >= lines_.line_start(line_ + 1))
+      {
+        out_ << '\n';
+        ++line_;
+        first_ = true;
+      }
+
+      if (not first_)
+      {
+        out_ << ' ';
+      }
+      first_ = false;
+
+      if (std::holds_alternative<tks::Error>(token.token))
+      {
+        out_ << std::format("<ERROR_TK: {}:{}>", line_, token.span.offset - lines_.line_start(line_) + 1);
+      }
+      else
+      {
+        out_ << tks::to_string(token.token);
+      }
+    }
+
+    // Terminates the current line and emits the empty ones left after it.
+    void finish()
+    {
+      for (; line_ <= lines_.lines(); ++line_)
+      {
+        out_ << '\n';
+      }
+    }
+
+  private:
+    std::ostream&         out_;
+    const src::LineIndex& lines_;
+    std::uint32_t         line_  = 1;
+    bool                  first_ = true;
+  };
+
+}
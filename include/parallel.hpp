@@ -0,0 +1,148 @@
+#pragma once
+
+#include "analyzers.hpp"
+#include "constants.hpp"
+#include "diagnostics.hpp"
+#include "tokens.hpp"
+#include "trace.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace parallel
+{
+
+  namespace detail
+  {
+
+    // Below this a chunk is not worth a task of its own, so small procs are
+    // grouped with the ones after them.
+    constant min_chunk = std::size_t{4096};
+
+    // Chunk boundaries: the start of the file and of every line whose first
+    // lexeme is `proc`, thinned out to at least min_chunk bytes apart. Since
+    // lexemes never span a newline, every line start is a safe split point.
+    inline auto proc_chunks(std::string_view source) -> std::vector<std::size_t>
+    {
+      auto starts = std::vector<std::size_t>{0};
+
+      for (auto line = std::size_t{0}; line < source.size(); )
+      {
+        auto first = source.find_first_not_of(' ', line);
+        if (first != std::string_view::npos
+            and source.substr(first).starts_with("proc")
+            and (first + 4 == source.size() or source[first + 4] == ' ' or source[first + 4] == '\n')
+            and line - starts.back() >= min_chunk)
+        {
+          starts.push_back(line);
+        }
+
+        const auto* newline = static_cast<const char*>(std::memchr(source.data() + line, '\n', source.size() - line));
+        line = newline ? static_cast<std::size_t>(newline - source.data()) + 1 : source.size();
+      }
+
+      starts.push_back(source.size());
+      return starts;
+    }
+
+    struct Chunk
+    {
+      std::vector<tks::Spanned> tokens;
+      diag::Sink                diagnostics;
+    };
+
+  }
+
+  // Lexes the procs of a file concurrently and emits the tokens in source
+  // order, exactly as analyzer::lex_each would. Every chunk interns into its
+  // worker's own table; the merge walks the chunks in order and renumbers
+  // identifiers by first occurrence, which is the serial numbering.
+  template<typename Emit>
+  void lex_each(std::string_view source, diag::Sink& diagnostics, const src::LineIndex& lines,
+                conc::WorkStealingPool& pool, Emit&& emit)
+  {
+    const auto starts = detail::proc_chunks(source);
+
+    auto chunks = std::vector<detail::Chunk>{};
+    chunks.reserve(starts.size() - 1);
+    for (auto i = std::size_t{1}; i < starts.size(); ++i)
+    {
+      chunks.push_back({.tokens = {}, .diagnostics = diag::Sink{diagnostics.limit(), lines}});
+    }
+
+    auto& literals = constants::pool();
+
+    pool.parallel_for(chunks.size(), [&](std::size_t i)
+    {
+      auto  scope = trace::Scope{"lex chunk", static_cast<std::int64_t>(i)};
+      auto  lent  = constants::PoolScope{literals};
+      auto& chunk = chunks[i];
+      auto  index = starts[i];
+
+      analyzer::reset_identifiers();
+
+      while (auto span = analyzer::detail::next_lexeme(source, index))
+      {
+        if (span->offset >= starts[i + 1])
+        {
+          break;
+        }
+        const auto lexeme = source.substr(span->offset, span->length);
+        chunk.tokens.push_back({analyzer::parse_all(lexeme, *span, chunk.diagnostics), *span});
+      }
+    });
+
+    auto scope = trace::Scope{"merge"};
+
+    // The calling thread lexed a chunk too; start its table over for the merge.
+    analyzer::reset_identifiers();
+
+    auto symbols = std::vector<std::size_t>{};
+
+    for (auto& chunk : chunks)
+    {
+      symbols.assign(symbols.size(), 0);
+
+      auto errors = std::size_t{0};
+
+      for (auto& [token, span] : chunk.tokens)
+      {
+        // A chunk only knew its own identifiers; suggest again now that all
+        // the earlier ones are interned, as the serial lexer would have.
+        if (std::holds_alternative<tks::Error>(token))
+        {
+          const auto entry = errors++;
+          const auto shown = diagnostics.entries().size() + entry < diagnostics.limit();
+
+          if (shown and entry < chunk.diagnostics.entries().size()
+              and chunk.diagnostics.entries()[entry].fault == tks::Fault::UnknownLexeme)
+          {
+            chunk.diagnostics.amend_suggestion(entry, analyzer::suggest(source.substr(span.offset, span.length)));
+          }
+        }
+
+        if (auto* id = std::get_if<tks::Id>(&token))
+        {
+          if (id->symbol >= symbols.size())
+          {
+            symbols.resize(id->symbol + 1, 0);
+          }
+          if (symbols[id->symbol] == 0)
+          {
+            symbols[id->symbol] = analyzer::intern(source.substr(span.offset, span.length));
+          }
+          id->symbol = symbols[id->symbol];
+        }
+        emit(tks::Spanned{token, span});
+      }
+
+      diagnostics.merge(chunk.diagnostics);
+    }
+  }
+
+}
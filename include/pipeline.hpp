@@ -0,0 +1,78 @@
+#pragma once
+
+#include "analyzers.hpp"
+#include "constants.hpp"
+#include "diagnostics.hpp"
+#include "spsc_ring.hpp"
+#include "tokens.hpp"
+#include "trace.hpp"
+
+#include <cstddef>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace pipeline
+{
+
+  struct Config
+  {
+    std::size_t batch_size    = 1024;
+    std::size_t ring_capacity = 16;
+  };
+
+  // Lexes on a worker thread and hands the tokens, in source order, to
+  // `consume` on the calling thread. Tokens travel in batches through an SPSC
+  // ring; a full ring stalls the lexer until the consumer catches up.
+  // The lexer thread interns into its own, fresh identifier table and the
+  // caller's constants pool, and is the only one touching the diagnostics
+  // until this returns.
+  template<typename Consume>
+  void run(std::string_view source, diag::Sink& diagnostics, Config config, Consume&& consume)
+  {
+    using Batch = std::vector<tks::Spanned>;
+
+    const auto batch_size = std::max<std::size_t>(config.batch_size, 1);
+    auto       ring       = conc::SpscRing<Batch>{config.ring_capacity};
+
+    auto& literals = constants::pool();
+
+    auto lexer = std::jthread([&]
+    {
+      trace::name_thread("lexer");
+      auto scope = trace::Scope{"lex"};
+      auto lent  = constants::PoolScope{literals};
+
+      auto batch = Batch{};
+      batch.reserve(batch_size);
+
+      analyzer::lex_each(source, diagnostics, false, [&](const tks::Spanned& token)
+      {
+        batch.push_back(token);
+        if (batch.size() == batch_size)
+        {
+          ring.push(std::exchange(batch, Batch{}));
+          batch.reserve(batch_size);
+        }
+      });
+
+      if (not batch.empty())
+      {
+        ring.push(std::move(batch));
+      }
+      ring.close();
+    });
+
+    auto scope = trace::Scope{"emit"};
+
+    while (auto batch = ring.pop())
+    {
+      for (const auto& token : *batch)
+      {
+        consume(token);
+      }
+    }
+  }
+
+}
@@ -0,0 +1,297 @@
+#pragma once
+
+#include "analyzers.hpp"
+#include "constants.hpp"
+#include "diagnostics.hpp"
+#include "output.hpp"
+#include "source.hpp"
+#include "tokens.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// Compilation as memoized queries over per-file inputs, in the spirit of
+// "red-green" incremental engines:
+//
+//   source(file)  input, set from outside
+//   tokens(file)  lexed tokens plus the rendered diagnostics
+//   procs(file)   names declared with `proc`, in order
+//   output(file)  the out.txt text
+//
+// Every query records the queries it read while running. After an input
+// changes, a memo is reused if none of its dependencies changed since it was
+// last verified; if it has to rerun and produces an equal value, its own
+// change revision stays put, so whatever depends on it is not rerun either
+// (early cutoff).
+namespace query
+{
+
+  using Revision = std::uint64_t;
+
+  enum struct Kind : std::uint8_t
+  {
+    Source,
+    Tokens,
+    Procs,
+    Output
+  };
+
+  struct Key
+  {
+    Kind        kind;
+    std::string file;
+  };
+
+  // Every lex gets a constants pool of its own, freed with the tokens once
+  // a newer, different lex replaces them.
+  struct Lexed
+  {
+    std::vector<tks::Spanned>        tokens;
+    std::string                      console;
+    std::size_t                      errors = 0;
+    std::shared_ptr<constants::Pool> literals;
+
+    // Number tokens of two lexes index different pools, so they are
+    // compared by the constant they hold.
+    friend auto operator==(const Lexed& a, const Lexed& b) -> bool
+    {
+      auto literal = [](const Token& token) -> std::optional<std::uint32_t>
+      {
+        if (const auto* number = std::get_if<tks::IntNum>(&token))   { return number->literal; }
+        if (const auto* number = std::get_if<tks::FloatNum>(&token)) { return number->literal; }
+        return std::nullopt;
+      };
+
+      auto same = [&](const tks::Spanned& x, const tks::Spanned& y)
+      {
+        const auto left = literal(x.token);
+        if (not left)
+        {
+          return tks::same(x, y);
+        }
+
+        return x.token.index() == y.token.index()
+           and x.span.offset == y.span.offset
+           and x.span.length == y.span.length
+           and (*a.literals)[*left] == (*b.literals)[*literal(y.token)];
+      };
+
+      return a.errors == b.errors
+         and a.console == b.console
+         and std::ranges::equal(a.tokens, b.tokens, same);
+    }
+  };
+
+  class Database
+  {
+  public:
+    explicit Database(std::size_t max_errors) : max_errors_{max_errors} {}
+
+    // Returns false (and starts no new revision) when the text is unchanged.
+    auto set_source(const std::string& file, std::string text) -> bool
+    {
+      auto [it, added] = sources_.try_emplace(file);
+      if (not added and it->second.value == text)
+      {
+        return false;
+      }
+
+      ++revision_;
+      it->second = {.value = std::move(text), .changed_at = revision_, .verified_at = revision_, .deps = {}};
+      return true;
+    }
+
+    // Forgets a file and everything derived from it.
+    void remove_source(const std::string& file)
+    {
+      ++revision_;
+      sources_.erase(file);
+      tokens_.erase(file);
+      procs_.erase(file);
+      outputs_.erase(file);
+    }
+
+    auto source(const std::string& file) -> const std::string&
+    {
+      record({Kind::Source, file});
+      return sources_[file].value;
+    }
+
+    auto tokens(const std::string& file) -> const Lexed&
+    {
+      record({Kind::Tokens, file});
+      return refresh_tokens(file).value;
+    }
+
+    auto procs(const std::string& file) -> const std::vector<std::string>&
+    {
+      record({Kind::Procs, file});
+      return refresh_procs(file).value;
+    }
+
+    auto output(const std::string& file) -> const std::string&
+    {
+      record({Kind::Output, file});
+      return refresh_output(file).value;
+    }
+
+    // Derived queries that actually ran, as opposed to being reused.
+    [[nodiscard]]
+    auto executions() const -> std::size_t
+    {
+      return executions_;
+    }
+
+  private:
+    template<typename T>
+    struct Memo
+    {
+      T                value{};
+      Revision         changed_at  = 0;
+      Revision         verified_at = 0;
+      std::vector<Key> deps;
+    };
+
+    template<typename T>
+    using Table = std::unordered_map<std::string, Memo<T>>;
+
+    void record(Key key)
+    {
+      if (not active_.empty())
+      {
+        active_.back().push_back(std::move(key));
+      }
+    }
+
+    // Brings the memo of `key` up to date and tells when its value last changed.
+    auto changed_at(const Key& key) -> Revision
+    {
+      switch (key.kind)
+      {
+        case Kind::Source: return sources_[key.file].changed_at;
+        case Kind::Tokens: return refresh_tokens(key.file).changed_at;
+        case Kind::Procs:  return refresh_procs(key.file).changed_at;
+        case Kind::Output: return refresh_output(key.file).changed_at;
+      }
+      return revision_;
+    }
+
+    template<typename T, typename Compute>
+    auto refresh(Table<T>& table, const std::string& file, Compute compute) -> Memo<T>&
+    {
+      auto [it, added] = table.try_emplace(file);
+      auto& memo       = it->second;
+
+      if (not added and memo.verified_at == revision_)
+      {
+        return memo;
+      }
+
+      if (not added and std::ranges::all_of(memo.deps, [&](const Key& dep) { return changed_at(dep) <= memo.verified_at; }))
+      {
+        memo.verified_at = revision_;
+        return memo;
+      }
+
+      active_.emplace_back();
+      auto value = compute();
+      ++executions_;
+
+      if (added or not (value == memo.value))
+      {
+        memo.value      = std::move(value);
+        memo.changed_at = revision_;
+      }
+      memo.verified_at = revision_;
+      memo.deps        = std::move(active_.back());
+      active_.pop_back();
+
+      return memo;
+    }
+
+    auto refresh_tokens(const std::string& file) -> Memo<Lexed>&
+    {
+      return refresh(tokens_, file, [&]
+      {
+        const auto& text  = source(file);
+        const auto  lines = src::LineIndex{text};
+        auto diagnostics  = diag::Sink{max_errors_, lines};
+
+        analyzer::reset_identifiers();
+
+        auto lexed     = Lexed{};
+        lexed.literals = std::make_shared<constants::Pool>();
+
+        auto lent     = constants::PoolScope{*lexed.literals};
+        auto console  = std::ostringstream{};
+        lexed.tokens  = analyzer::lex(text, diagnostics);
+        lexed.errors  = diagnostics.count();
+        diagnostics.flush(console);
+        lexed.console = std::move(console).str();
+
+        return lexed;
+      });
+    }
+
+    auto refresh_procs(const std::string& file) -> Memo<std::vector<std::string>>&
+    {
+      return refresh(procs_, file, [&]
+      {
+        const auto& lexed = tokens(file);
+        const auto& text  = source(file);
+
+        auto names    = std::vector<std::string>{};
+        auto previous = false;
+        for (const auto& [token, span] : lexed.tokens)
+        {
+          if (previous and std::holds_alternative<tks::Id>(token))
+          {
+            names.emplace_back(text.substr(span.offset, span.length));
+          }
+          previous = std::holds_alternative<tks::Proc>(token);
+        }
+        return names;
+      });
+    }
+
+    auto refresh_output(const std::string& file) -> Memo<std::string>&
+    {
+      return refresh(outputs_, file, [&]
+      {
+        const auto& lexed = tokens(file);
+        const auto  lines = src::LineIndex{source(file)};
+
+        auto lent   = constants::PoolScope{*lexed.literals};
+        auto out    = std::ostringstream{};
+        auto writer = output::LineWriter{out, lines};
+        for (const auto& token : lexed.tokens)
+        {
+          writer.write(token);
+        }
+        writer.finish();
+
+        return std::move(out).str();
+      });
+    }
+
+    std::size_t                   max_errors_;
+    Revision                      revision_   = 0;
+    std::size_t                   executions_ = 0;
+    std::vector<std::vector<Key>> active_;
+
+    Table<std::string>              sources_;
+    Table<Lexed>                    tokens_;
+    Table<std::vector<std::string>> procs_;
+    Table<std::string>              outputs_;
+  };
+
+}
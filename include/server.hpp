@@ -0,0 +1,665 @@
+#pragma once
+
+#include "driver.hpp"
+#include "interrupt.hpp"
+#include "options.hpp"
+#include "source.hpp"
+#include "thread_pool.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <print>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// A warm compile process behind a Unix domain socket.
+//
+// Protocol, one connection may carry any number of requests:
+//   request:  <max errors> <prune procs 0|1> <jobs> <absolute path of the input>\n
+//   reply:    <exit status> <out bytes> <console bytes>\n<out><console>
+// where <out> is what a cold run writes to out.txt and <console> what it
+// prints to stdout.
+namespace server
+{
+
+  struct Reply
+  {
+    int         status = EXIT_FAILURE;
+    std::string out;
+    std::string console;
+  };
+
+  namespace detail
+  {
+
+    // Longest request line accepted before the connection is dropped.
+    constant max_request = std::size_t{4096};
+
+    // Bytes of cached reply text kept across all files.
+    constant cache_budget = std::size_t{64} << 20;
+
+    class Socket
+    {
+    public:
+      Socket() = default;
+      explicit Socket(int fd) : fd_{fd} {}
+
+      Socket(Socket&& other) noexcept : fd_{std::exchange(other.fd_, -1)} {}
+
+      Socket& operator=(Socket&& other) noexcept
+      {
+        std::swap(fd_, other.fd_);
+        return *this;
+      }
+
+      ~Socket()
+      {
+        if (fd_ >= 0)
+        {
+          ::close(fd_);
+        }
+      }
+
+      [[nodiscard]]
+      auto fd() const -> int
+      {
+        return fd_;
+      }
+
+    private:
+      int fd_ = -1;
+    };
+
+    inline auto address(const std::filesystem::path& path) -> std::expected<sockaddr_un, std::string>
+    {
+      auto addr = sockaddr_un{};
+      addr.sun_family = AF_UNIX;
+
+      const auto& name = path.native();
+      if (name.size() >= sizeof(addr.sun_path))
+      {
+        return std::unexpected(std::format("socket path \"{}\" is too long", name));
+      }
+      std::memcpy(addr.sun_path, name.c_str(), name.size() + 1);
+
+      return addr;
+    }
+
+    inline auto write_all(int fd, std::string_view data) -> bool
+    {
+      while (not data.empty())
+      {
+        const auto sent = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent <= 0)
+        {
+          return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(sent));
+      }
+      return true;
+    }
+
+    // Buffered reads off a stream socket.
+    class Reader
+    {
+    public:
+      explicit Reader(int fd) : fd_{fd} {}
+
+      auto line() -> std::optional<std::string>
+      {
+        while (true)
+        {
+          if (auto result = buffered_line())
+          {
+            return result;
+          }
+
+          if (overlong() or not fill())
+          {
+            return std::nullopt;
+          }
+        }
+      }
+
+      // A line that has already arrived, without waiting for more.
+      auto buffered_line() -> std::optional<std::string>
+      {
+        const auto newline = buffer_.find('\n');
+        if (newline == std::string::npos)
+        {
+          return std::nullopt;
+        }
+
+        auto result = buffer_.substr(0, newline);
+        buffer_.erase(0, newline + 1);
+        return result;
+      }
+
+      // More than a request's worth of bytes without a newline.
+      [[nodiscard]]
+      auto overlong() const -> bool
+      {
+        return buffer_.size() > max_request and buffer_.find('\n') == std::string::npos;
+      }
+
+      // One read; false once the peer is gone.
+      auto fill() -> bool
+      {
+        char chunk[64 * 1024];
+        const auto received = ::recv(fd_, chunk, sizeof(chunk), 0);
+        if (received <= 0)
+        {
+          return false;
+        }
+        buffer_.append(chunk, static_cast<std::size_t>(received));
+        return true;
+      }
+
+      auto exactly(std::size_t size) -> std::optional<std::string>
+      {
+        while (buffer_.size() < size)
+        {
+          if (not fill())
+          {
+            return std::nullopt;
+          }
+        }
+
+        auto result = buffer_.substr(0, size);
+        buffer_.erase(0, size);
+        return result;
+      }
+
+    private:
+      int         fd_;
+      std::string buffer_;
+    };
+
+    // Reads space separated numbers off a reply header, e.g. "1 120 64".
+    template<typename ...Fields>
+    auto decode(std::string_view header, Fields&... fields) -> bool
+    {
+      const auto* it  = header.data();
+      const auto* end = it + header.size();
+
+      auto field = [&](auto& value)
+      {
+        auto [ptr, ec] = std::from_chars(it, end, value);
+        if (ec != std::errc{} or (ptr != end and *ptr != ' '))
+        {
+          return false;
+        }
+        it = ptr == end ? ptr : ptr + 1;
+        return true;
+      };
+
+      return (field(fields) and ...) and it == end;
+    }
+
+    // Options of the run the client stands in for, on top of the server's own.
+    inline auto encode_request(const std::string& path, const cli::Options& options) -> std::string
+    {
+      return std::format("{} {} {} {}\n", options.max_errors, options.prune_procs ? 1 : 0, options.jobs, path);
+    }
+
+    inline auto decode_request(std::string_view line, cli::Options options) -> std::optional<std::pair<cli::Options, std::string>>
+    {
+      auto path = std::size_t{0};
+      for (auto field = 0; field < 3; ++field)
+      {
+        const auto space = line.find(' ', path);
+        if (space == std::string_view::npos)
+        {
+          return std::nullopt;
+        }
+        path = space + 1;
+      }
+
+      auto prune = 0u;
+      if (not decode(line.substr(0, path - 1), options.max_errors, prune, options.jobs) or prune > 1 or options.jobs == 0)
+      {
+        return std::nullopt;
+      }
+      options.prune_procs = prune == 1;
+      options.jobs        = std::min<std::size_t>(options.jobs, std::max(std::thread::hardware_concurrency(), 1u));
+
+      return std::pair{options, std::string{line.substr(path)}};
+    }
+
+    inline auto encode(const Reply& reply) -> std::string
+    {
+      return std::format("{} {} {}\n{}{}", reply.status, reply.out.size(), reply.console.size(), reply.out, reply.console);
+    }
+
+    // Replies of files that have not changed since, keyed by path and the
+    // options that shape the output. Bounded by the bytes of text held: the
+    // least recently used replies go first.
+    class ReplyCache
+    {
+    public:
+      explicit ReplyCache(std::size_t budget) : budget_{budget} {}
+
+      auto find(const std::string& key, std::filesystem::file_time_type modified, std::uintmax_t size) -> std::optional<Reply>
+      {
+        auto lock = std::scoped_lock{mutex_};
+
+        const auto it = index_.find(key);
+        if (it == index_.end() or it->second->modified != modified or it->second->size != size)
+        {
+          return std::nullopt;
+        }
+
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->reply;
+      }
+
+      void insert(const std::string& key, std::filesystem::file_time_type modified, std::uintmax_t size, Reply reply)
+      {
+        auto lock = std::scoped_lock{mutex_};
+
+        if (const auto it = index_.find(key); it != index_.end())
+        {
+          drop(it->second);
+        }
+
+        const auto cost = key.size() + reply.out.size() + reply.console.size();
+        if (cost > budget_)
+        {
+          return;
+        }
+
+        entries_.push_front({.key = key, .modified = modified, .size = size, .cost = cost, .reply = std::move(reply)});
+        index_.emplace(key, entries_.begin());
+        used_ += cost;
+
+        while (used_ > budget_)
+        {
+          drop(std::prev(entries_.end()));
+        }
+      }
+
+    private:
+      struct Entry
+      {
+        std::string                     key;
+        std::filesystem::file_time_type modified;
+        std::uintmax_t                  size;
+        std::size_t                     cost;
+        Reply                           reply;
+      };
+
+      void drop(std::list<Entry>::iterator entry)
+      {
+        used_ -= entry->cost;
+        index_.erase(entry->key);
+        entries_.erase(entry);
+      }
+
+      std::mutex                                                    mutex_;
+      std::size_t                                                   budget_;
+      std::size_t                                                   used_ = 0;
+      std::list<Entry>                                              entries_; // most recently used first
+      std::unordered_map<std::string, std::list<Entry>::iterator>   index_;
+    };
+
+  }
+
+  // Accepts connections and reads requests on the calling thread, which
+  // polls every idle connection; each request is one job on the pool, so a
+  // connection only holds a worker while one of its requests is compiled.
+  // A connection has at most one request in flight, which keeps its replies
+  // in order. Replies are cached per path and options, and reused while the
+  // file's size and modification time stay the same, up to
+  // detail::cache_budget bytes.
+  class Server
+  {
+  public:
+    explicit Server(cli::Options options, std::size_t threads = std::thread::hardware_concurrency())
+      : options_{std::move(options)}
+      , lex_pool_{std::max(std::thread::hardware_concurrency(), 2u) - 1}
+      , pool_{threads}
+    {
+    }
+
+    auto run(const std::filesystem::path& socket_path) -> int
+    {
+      auto addr = detail::address(socket_path);
+      if (not addr)
+      {
+        std::println("[Error] {}", addr.error());
+        return EXIT_FAILURE;
+      }
+
+      auto listener = detail::Socket{::socket(AF_UNIX, SOCK_STREAM, 0)};
+
+      // A socket left behind by a previous server would make bind() fail.
+      if (auto ec = std::error_code{}; std::filesystem::is_socket(socket_path, ec))
+      {
+        std::filesystem::remove(socket_path, ec);
+      }
+
+      if (listener.fd() < 0
+          or ::bind(listener.fd(), reinterpret_cast<const sockaddr*>(&*addr), sizeof(*addr)) != 0
+          or ::listen(listener.fd(), SOMAXCONN) != 0)
+      {
+        std::println("[Error] cannot listen on {}: {}", socket_path.string(), std::strerror(errno));
+        return EXIT_FAILURE;
+      }
+
+      auto wake = std::array<int, 2>{};
+      if (::pipe2(wake.data(), O_CLOEXEC | O_NONBLOCK) != 0)
+      {
+        std::println("[Error] cannot create a pipe: {}", std::strerror(errno));
+        return EXIT_FAILURE;
+      }
+      wake_read_  = detail::Socket{wake[0]};
+      wake_write_ = detail::Socket{wake[1]};
+
+      const auto stop = detail::Socket{interrupt::descriptor()};
+
+      std::println("[INFO] listening on {} with {} worker(s)", socket_path.string(), pool_.size());
+
+      auto polled = std::vector<pollfd>{};
+      while (true)
+      {
+        polled.clear();
+        polled.push_back({.fd = listener.fd(), .events = POLLIN, .revents = 0});
+        polled.push_back({.fd = wake_read_.fd(), .events = POLLIN, .revents = 0});
+        polled.push_back({.fd = stop.fd(), .events = POLLIN, .revents = 0});
+        for (const auto& [fd, connection] : connections_)
+        {
+          if (not connection.busy)
+          {
+            polled.push_back({.fd = fd, .events = POLLIN, .revents = 0});
+          }
+        }
+
+        if (::poll(polled.data(), polled.size(), -1) < 0)
+        {
+          if (errno == EINTR)
+          {
+            continue;
+          }
+          std::println("[Error] poll failed: {}", std::strerror(errno));
+          return EXIT_FAILURE;
+        }
+
+        // Requests already handed to the pool are answered before the pool
+        // shuts down; the connections are closed after that.
+        if (polled[2].revents != 0)
+        {
+          std::println("[INFO] stopping");
+          auto ec = std::error_code{};
+          std::filesystem::remove(socket_path, ec);
+          return EXIT_SUCCESS;
+        }
+
+        if (polled[1].revents != 0)
+        {
+          take_back();
+        }
+
+        for (auto index = std::size_t{3}; index < polled.size(); ++index)
+        {
+          if (polled[index].revents != 0)
+          {
+            receive(polled[index].fd);
+          }
+        }
+
+        if (polled[0].revents != 0)
+        {
+          const auto fd = ::accept4(listener.fd(), nullptr, nullptr, SOCK_CLOEXEC);
+          if (fd >= 0)
+          {
+            connections_.try_emplace(fd, detail::Socket{fd}, detail::Reader{fd});
+          }
+          else if (errno != EINTR and errno != ECONNABORTED)
+          {
+            std::println("[Error] accept failed: {}", std::strerror(errno));
+            return EXIT_FAILURE;
+          }
+        }
+      }
+    }
+
+  private:
+    // Owned by the polling thread; a worker only writes the reply to the
+    // socket of the connection it was handed.
+    struct Connection
+    {
+      Connection(detail::Socket socket, detail::Reader reader) : socket{std::move(socket)}, reader{std::move(reader)} {}
+
+      detail::Socket socket;
+      detail::Reader reader;
+      bool           busy = false;
+    };
+
+    void receive(int fd)
+    {
+      auto& connection = connections_.at(fd);
+      if (not connection.reader.fill())
+      {
+        connections_.erase(fd);
+        return;
+      }
+      dispatch(fd, connection);
+    }
+
+    // Hands the next request that has fully arrived to the pool.
+    void dispatch(int fd, Connection& connection)
+    {
+      auto request = connection.reader.buffered_line();
+      if (not request)
+      {
+        if (connection.reader.overlong())
+        {
+          connections_.erase(fd);
+        }
+        return;
+      }
+
+      connection.busy = true;
+      pool_.submit([this, fd, request = std::move(*request)]
+      {
+        const auto sent = detail::write_all(fd, detail::encode(answer(request)));
+        {
+          auto lock = std::scoped_lock{finished_mutex_};
+          finished_.emplace_back(fd, sent);
+        }
+
+        // A full pipe already has the polling thread on its way.
+        const auto byte = char{0};
+        [[maybe_unused]] const auto written = ::write(wake_write_.fd(), &byte, 1);
+      });
+    }
+
+    // Connections whose request has been answered go back to being polled,
+    // or straight to the pool if the next request is already buffered.
+    void take_back()
+    {
+      char drain[256];
+      while (::read(wake_read_.fd(), drain, sizeof(drain)) > 0)
+      {
+      }
+
+      auto finished = std::vector<std::pair<int, bool>>{};
+      {
+        auto lock = std::scoped_lock{finished_mutex_};
+        finished.swap(finished_);
+      }
+
+      for (const auto& [fd, usable] : finished)
+      {
+        auto& connection = connections_.at(fd);
+        connection.busy = false;
+
+        if (not usable)
+        {
+          connections_.erase(fd);
+          continue;
+        }
+        dispatch(fd, connection);
+      }
+    }
+
+    auto answer(std::string_view request) -> Reply
+    {
+      auto decoded = detail::decode_request(request, options_);
+      if (not decoded)
+      {
+        return {.status = EXIT_FAILURE, .out = {}, .console = "[Error] malformed request\n"};
+      }
+
+      const auto& [options, path] = *decoded;
+      return compile(path, options);
+    }
+
+    auto compile(const std::string& path, const cli::Options& options) -> Reply
+    {
+      // --jobs only changes how the work is split, not what comes out.
+      const auto key = std::format("{} {} {}", options.max_errors, options.prune_procs ? 1 : 0, path);
+
+      auto ec       = std::error_code{};
+      auto modified = std::filesystem::last_write_time(path, ec);
+      auto size     = ec ? std::uintmax_t{0} : std::filesystem::file_size(path, ec);
+
+      if (not ec)
+      {
+        if (auto cached = cache_.find(key, modified, size))
+        {
+          return std::move(*cached);
+        }
+      }
+
+      auto input_file = std::ifstream(path);
+      if (not input_file.is_open())
+      {
+        return {.status = EXIT_FAILURE, .out = {}, .console = "[Error] input_file cannot be oppended !!\n"};
+      }
+
+      auto source = src::read(input_file);
+      if (not source)
+      {
+        return {.status = EXIT_FAILURE, .out = {}, .console = std::format("[Error] input_file cannot be read: {}\n", source.error())};
+      }
+
+      auto out     = std::ostringstream{};
+      auto console = std::ostringstream{};
+      auto reply   = Reply{};
+
+      reply.status  = driver::compile(*source, out, console, options, &lex_pool_);
+      reply.out     = std::move(out).str();
+      reply.console = std::move(console).str();
+
+      if (not ec)
+      {
+        cache_.insert(key, modified, size, reply);
+      }
+
+      return reply;
+    }
+
+    cli::Options                                options_;
+    detail::ReplyCache                          cache_{detail::cache_budget};
+    std::unordered_map<int, Connection>         connections_;
+    detail::Socket                              wake_read_;  // pipe the workers use to wake the polling thread
+    detail::Socket                              wake_write_;
+    std::mutex                                  finished_mutex_;
+    std::vector<std::pair<int, bool>>           finished_;   // answered connections, and whether they are still usable
+    conc::WorkStealingPool                      lex_pool_;   // splits --jobs requests by proc, shared by all of them
+    conc::ThreadPool                            pool_;
+  };
+
+  // A connection to a running server; requests on it are answered in order.
+  class Client
+  {
+  public:
+    static auto connect(const std::filesystem::path& socket_path) -> std::expected<Client, std::string>
+    {
+      auto addr = detail::address(socket_path);
+      if (not addr)
+      {
+        return std::unexpected(addr.error());
+      }
+
+      auto socket = detail::Socket{::socket(AF_UNIX, SOCK_STREAM, 0)};
+      if (socket.fd() < 0 or ::connect(socket.fd(), reinterpret_cast<const sockaddr*>(&*addr), sizeof(*addr)) != 0)
+      {
+        return std::unexpected(std::format("cannot connect to {}: {}", socket_path.string(), std::strerror(errno)));
+      }
+
+      return Client{std::move(socket)};
+    }
+
+    // `options` carries --max-errors, --prune-procs and --jobs over to the server.
+    auto compile(const std::filesystem::path& input, const cli::Options& options) -> std::expected<Reply, std::string>
+    {
+      const auto path = std::filesystem::absolute(input).string();
+      if (path.find('\n') != std::string::npos)
+      {
+        return std::unexpected(std::string{"input path contains a newline"});
+      }
+
+      if (not detail::write_all(socket_.fd(), detail::encode_request(path, options)))
+      {
+        return std::unexpected(std::string{"server closed the connection"});
+      }
+
+      const auto header = reader_.line();
+      if (not header)
+      {
+        return std::unexpected(std::string{"server closed the connection"});
+      }
+
+      auto reply        = Reply{};
+      auto out_size     = std::size_t{};
+      auto console_size = std::size_t{};
+
+      const auto ok = detail::decode(*header, reply.status, out_size, console_size);
+
+      auto out     = ok ? reader_.exactly(out_size)     : std::nullopt;
+      auto console = out ? reader_.exactly(console_size) : std::nullopt;
+      if (not console)
+      {
+        return std::unexpected(std::format("malformed reply \"{}\"", *header));
+      }
+
+      reply.out     = std::move(*out);
+      reply.console = std::move(*console);
+      return reply;
+    }
+
+  private:
+    explicit Client(detail::Socket socket) : socket_{std::move(socket)}, reader_{socket_.fd()} {}
+
+    detail::Socket socket_;
+    detail::Reader reader_;
+  };
+
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <fstream>
+#include <limits>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace src
+{
+
+  struct Location
+  {
+    std::uint32_t line;
+    std::uint32_t column;
+  };
+
+  // Start offset of every line of a file, built once with a single newline scan.
+  // Tokens only store byte offsets, lines and columns are resolved on demand.
+  class LineIndex
+  {
+  public:
+    LineIndex() = default;
+
+    explicit LineIndex(std::string_view source, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : starts_(1, 0, resource)
+      , ends_with_newline_{source.ends_with('\n')}
+      , empty_{source.empty()}
+    {
+      const auto* const begin = source.data();
+      const auto* const end   = begin + source.size();
+      const auto*       it    = begin;
+
+#if defined(__SSE2__)
+      const auto newline = _mm_set1_epi8('\n');
+
+      for (; end - it >= 16; it += 16)
+      {
+        const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+        auto       mask  = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+
+        while (mask != 0)
+        {
+          starts_.push_back(static_cast<std::uint32_t>(it - begin + std::countr_zero(mask) + 1));
+          mask &= mask - 1;
+        }
+      }
+#endif
+
+      while (const auto* found = static_cast<const char*>(std::memchr(it, '\n', static_cast<std::size_t>(end - it))))
+      {
+        starts_.push_back(static_cast<std::uint32_t>(found - begin + 1));
+        it = found + 1;
+      }
+    }
+
+    // Number of lines as `std::getline` would see them.
+    [[nodiscard]]
+    auto lines() const -> std::uint32_t
+    {
+      if (empty_)
+      {
+        return 0;
+      }
+
+      return static_cast<std::uint32_t>(starts_.size() - (ends_with_newline_ ? 1 : 0));
+    }
+
+    // Offset of the first byte of `line` (1-based).
+    [[nodiscard]]
+    auto line_start(std::uint32_t line) const -> std::uint32_t
+    {
+      return starts_.at(line - 1);
+    }
+
+    [[nodiscard]]
+    auto location(std::uint32_t offset) const -> Location
+    {
+      const auto it   = std::ranges::upper_bound(starts_, offset);
+      const auto line = static_cast<std::uint32_t>(it - starts_.begin());
+
+      return {.line = line, .column = offset - starts_[line - 1] + 1};
+    }
+
+  private:
+    std::pmr::vector<std::uint32_t> starts_;
+    bool                       ends_with_newline_ = false;
+    bool                       empty_             = true;
+  };
+
+  // Reads the whole stream; spans are 32-bit, so larger inputs are refused.
+  // A regular file is sized up front and usually read in a single call, a
+  // pipe or FIFO cannot seek and is read in growing blocks until it ends.
+  inline auto read(std::ifstream& file) -> std::expected<std::string, std::string>
+  {
+    using traits = std::ifstream::traits_type;
+
+    constexpr auto limit = std::size_t{std::numeric_limits<std::uint32_t>::max()};
+    constexpr auto block = std::size_t{64 * 1024};
+
+    file.seekg(0, std::ios::end);
+    const auto end = file.tellg();
+    file.clear();
+    file.seekg(0, std::ios::beg);
+    file.clear();
+
+    const auto seekable = end != std::streampos(-1);
+
+    if (seekable and static_cast<std::uint64_t>(end) > limit)
+    {
+      return std::unexpected(std::string{"input is larger than 4 GiB"});
+    }
+
+    auto* stream = file.rdbuf();
+    auto  buffer = std::string(seekable ? static_cast<std::size_t>(end) : block, '\0');
+    auto  used   = std::size_t{0};
+
+    while (true)
+    {
+      if (used == buffer.size())
+      {
+        if (traits::eq_int_type(stream->sgetc(), traits::eof()))
+        {
+          break;
+        }
+
+        if (used == limit)
+        {
+          return std::unexpected(std::string{"input is larger than 4 GiB"});
+        }
+        buffer.resize(std::min(limit, std::max(block, 2 * buffer.size())));
+      }
+
+      const auto got = stream->sgetn(buffer.data() + used, static_cast<std::streamsize>(buffer.size() - used));
+      if (got <= 0)
+      {
+        break;
+      }
+      used += static_cast<std::size_t>(got);
+    }
+
+    buffer.resize(used);
+    return buffer;
+  }
+
+}
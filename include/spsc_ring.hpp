@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace conc
+{
+
+  // Bounded lock-free ring for exactly one producer and one consumer thread.
+  // Each side caches the other's index and only reloads it when the ring
+  // looks full (or empty), so the shared cache lines are touched rarely.
+  template<typename T>
+  class SpscRing
+  {
+  public:
+    explicit SpscRing(std::size_t capacity)
+      : slots_(std::bit_ceil(std::max<std::size_t>(capacity, 2)))
+      , mask_{slots_.size() - 1}
+    {
+    }
+
+    SpscRing(const SpscRing&)            = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    [[nodiscard]]
+    auto try_push(T& value) -> bool
+    {
+      const auto tail = tail_.load(std::memory_order_relaxed);
+
+      if (tail - head_cache_ == slots_.size())
+      {
+        head_cache_ = head_.load(std::memory_order_acquire);
+        if (tail - head_cache_ == slots_.size())
+        {
+          return false;
+        }
+      }
+
+      slots_[tail & mask_] = std::move(value);
+      tail_.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    [[nodiscard]]
+    auto try_pop(T& value) -> bool
+    {
+      const auto head = head_.load(std::memory_order_relaxed);
+
+      if (head == tail_cache_)
+      {
+        tail_cache_ = tail_.load(std::memory_order_acquire);
+        if (head == tail_cache_)
+        {
+          return false;
+        }
+      }
+
+      value = std::move(slots_[head & mask_]);
+      head_.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Blocks while the ring is full; this is the backpressure on the producer.
+    void push(T value)
+    {
+      for (auto spins = 0u; not try_push(value); ++spins)
+      {
+        backoff(spins);
+      }
+    }
+
+    // Blocks until an item arrives, empty once the producer closed the ring
+    // and everything before the close was consumed.
+    [[nodiscard]]
+    auto pop() -> std::optional<T>
+    {
+      auto value = T{};
+
+      for (auto spins = 0u; ; ++spins)
+      {
+        if (try_pop(value))
+        {
+          return value;
+        }
+
+        if (closed_.load(std::memory_order_acquire))
+        {
+          return try_pop(value) ? std::optional{std::move(value)} : std::nullopt;
+        }
+
+        backoff(spins);
+      }
+    }
+
+    void close()
+    {
+      closed_.store(true, std::memory_order_release);
+    }
+
+  private:
+    static void backoff(unsigned spins)
+    {
+      if (spins > 64)
+      {
+        std::this_thread::yield();
+      }
+    }
+
+    static constexpr auto cache_line = std::size_t{64};
+
+    std::vector<T>    slots_;
+    const std::size_t mask_;
+
+    alignas(cache_line) std::atomic<std::size_t> head_ = 0;
+    std::size_t                                  tail_cache_ = 0;
+
+    alignas(cache_line) std::atomic<std::size_t> tail_ = 0;
+    std::size_t                                  head_cache_ = 0;
+
+    alignas(cache_line) std::atomic<bool>        closed_ = false;
+  };
+
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace suggest
+{
+
+  // Spelling index over a growing set of words. The words share a trie, and
+  // a lookup walks it carrying one edit-distance row per depth: a branch is
+  // left as soon as every entry of its row is past the tolerance, so only
+  // prefixes that can still end within reach of the query are visited,
+  // however many words there are.
+  class Index
+  {
+  public:
+    struct Match
+    {
+      std::size_t  key;
+      std::int32_t distance;
+    };
+
+    explicit Index(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : nodes_{resource}
+    {
+      clear();
+    }
+
+    // Words inserted so far, duplicates included.
+    [[nodiscard]]
+    auto size() const -> std::size_t
+    {
+      return words_;
+    }
+
+    void clear()
+    {
+      nodes_.assign(1, Node{.label = '\0', .child = none, .sibling = none, .key = absent});
+      words_ = 0;
+      depth_ = 0;
+    }
+
+    // A word inserted twice keeps its first key.
+    void insert(std::string_view word, std::size_t key)
+    {
+      auto at = std::uint32_t{0};
+
+      for (const auto c : word)
+      {
+        auto child = nodes_[at].child;
+        while (child != none and nodes_[child].label != c)
+        {
+          child = nodes_[child].sibling;
+        }
+
+        if (child == none)
+        {
+          child = static_cast<std::uint32_t>(nodes_.size());
+          nodes_.push_back({.label = c, .child = none, .sibling = nodes_[at].child, .key = absent});
+          nodes_[at].child = child;
+        }
+        at = child;
+      }
+
+      if (nodes_[at].key == absent)
+      {
+        nodes_[at].key = key;
+      }
+      depth_ = std::max(depth_, word.size());
+      ++words_;
+    }
+
+    // Closest word within `tolerance` edits, ties going to the smallest key,
+    // so the answer does not depend on insertion order. Tolerances are tried
+    // in increasing order: a walk one edit narrower visits a small fraction
+    // of the nodes, and most misspellings are found before the widest one.
+    [[nodiscard]]
+    auto nearest(std::string_view word, std::int32_t tolerance) const -> std::optional<Match>
+    {
+      for (auto within = std::int32_t{0}; within <= tolerance and words_ != 0; ++within)
+      {
+        if (auto found = walk(word, within))
+        {
+          return found;
+        }
+      }
+      return std::nullopt;
+    }
+
+  private:
+    static constexpr auto none   = static_cast<std::uint32_t>(-1);
+    static constexpr auto absent = static_cast<std::size_t>(-1);
+
+    struct Node
+    {
+      char          label;
+      std::uint32_t child;   // most recently added child
+      std::uint32_t sibling; // next child of the same parent
+      std::size_t   key;     // `absent` unless a word ends here
+    };
+
+    auto walk(std::string_view word, std::int32_t tolerance) const -> std::optional<Match>
+    {
+      // Below this depth every entry of a row exceeds the tolerance.
+      const auto width   = word.size() + 1;
+      const auto deepest = std::min(depth_, word.size() + static_cast<std::size_t>(tolerance) + 1);
+
+      auto scratch = std::array<std::byte, 2048>{};
+      auto arena   = std::pmr::monotonic_buffer_resource{scratch.data(), scratch.size()};
+      auto rows    = std::pmr::vector<std::int32_t>((deepest + 1) * width, &arena);
+      auto pending = std::pmr::vector<std::pair<std::uint32_t, std::size_t>>{&arena};
+
+      for (auto j = std::size_t{0}; j < width; ++j)
+      {
+        rows[j] = static_cast<std::int32_t>(j);
+      }
+
+      auto best = std::optional<Match>{};
+      auto visit = [&](std::uint32_t node, std::int32_t distance)
+      {
+        const auto key = nodes_[node].key;
+        if (key != absent and distance <= tolerance and (not best or distance < best->distance or key < best->key))
+        {
+          best      = Match{.key = key, .distance = distance};
+          tolerance = distance;
+        }
+      };
+
+      visit(0, rows[width - 1]);
+      for (auto child = nodes_[0].child; child != none; child = nodes_[child].sibling)
+      {
+        pending.emplace_back(child, 1);
+      }
+
+      // Depth-first, so the row of a node's parent is still the last one
+      // written one level up when the node is taken off the stack.
+      while (not pending.empty())
+      {
+        const auto [node, depth] = pending.back();
+        pending.pop_back();
+
+        const auto* above = rows.data() + (depth - 1) * width;
+        auto*       row   = rows.data() + depth * width;
+        const auto  label = nodes_[node].label;
+
+        row[0]      = static_cast<std::int32_t>(depth);
+        auto lowest = row[0];
+        for (auto j = std::size_t{1}; j < width; ++j)
+        {
+          row[j] = std::min({above[j] + 1, row[j - 1] + 1, above[j - 1] + (word[j - 1] == label ? 0 : 1)});
+          lowest = std::min(lowest, row[j]);
+        }
+
+        visit(node, row[width - 1]);
+
+        if (lowest <= tolerance)
+        {
+          for (auto child = nodes_[node].child; child != none; child = nodes_[child].sibling)
+          {
+            pending.emplace_back(child, depth + 1);
+          }
+        }
+      }
+      return best;
+    }
+
+    std::pmr::vector<Node> nodes_;
+    std::size_t            words_ = 0;
+    std::size_t            depth_ = 0;
+  };
+
+}
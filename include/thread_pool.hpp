@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace conc
+{
+
+  // Fixed set of workers pulling jobs from one shared queue. Jobs still queued
+  // when the pool is destroyed are run before the workers exit.
+  class ThreadPool
+  {
+  public:
+    explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency())
+    {
+      threads = std::max<std::size_t>(threads, 1);
+      workers_.reserve(threads);
+
+      for (auto i = std::size_t{0}; i < threads; ++i)
+      {
+        workers_.emplace_back([this] { work(); });
+      }
+    }
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+      {
+        auto lock = std::scoped_lock{mutex_};
+        stopping_ = true;
+      }
+      ready_.notify_all();
+    }
+
+    [[nodiscard]]
+    auto size() const -> std::size_t
+    {
+      return workers_.size();
+    }
+
+    void submit(std::function<void()> job)
+    {
+      {
+        auto lock = std::scoped_lock{mutex_};
+        jobs_.push_back(std::move(job));
+      }
+      ready_.notify_one();
+    }
+
+  private:
+    void work()
+    {
+      while (true)
+      {
+        auto job = std::function<void()>{};
+        {
+          auto lock = std::unique_lock{mutex_};
+          ready_.wait(lock, [this] { return stopping_ or not jobs_.empty(); });
+
+          if (jobs_.empty())
+          {
+            return;
+          }
+          job = std::move(jobs_.front());
+          jobs_.pop_front();
+        }
+        job();
+      }
+    }
+
+    std::mutex                        mutex_;
+    std::condition_variable           ready_;
+    std::deque<std::function<void()>> jobs_;
+    bool                              stopping_ = false;
+    std::vector<std::jthread>         workers_;
+  };
+
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "constants.hpp"
+
 #include <cstdint>
 #include <format>
 #include <string>
@@ -8,14 +10,33 @@
 namespace tks
 {
 
+  // Byte range of a token in its source file, see src::LineIndex for lines and columns.
+  struct Span
+  {
+    std::uint32_t offset;
+    std::uint32_t length;
+  };
+
   struct Unknown 
   {
     
   };
 
+  enum struct Fault : std::uint8_t
+  {
+    UnknownLexeme,
+    OutOfRange,
+    InvalidEncoding
+  };
+
+  struct Error
+  {
+    Fault fault = Fault::UnknownLexeme;
+  };
+
   struct Id
   {
-    std::size_t symbol;
+    std::uint32_t symbol;
   };
 
   struct If 
@@ -85,12 +106,12 @@ namespace tks
 
   struct IntNum 
   {
-    std::uint64_t value;
+    std::uint32_t literal; // index into constants::pool()
   };
 
   struct FloatNum 
   {
-    double value;
+    std::uint32_t literal; // index into constants::pool()
   };
 
   struct ParanOpen 
@@ -177,6 +198,7 @@ namespace tks
 
 using Token = std::variant<
     tks::Unknown,
+    tks::Error,
     tks::Id,
     tks::If, tks::Else, tks::For, tks::Elif, tks::Proc, tks::Var, tks::Run, tks::Return,
     tks::Int, tks::Float, tks::Bool, tks::True, tks::False,
@@ -193,6 +215,12 @@ using Token = std::variant<
 namespace tks
 {
 
+  struct Spanned
+  {
+    Token token;
+    Span  span;
+  };
+
   template<typename ...Ts>
   struct overload : public Ts...
   {
@@ -207,6 +235,7 @@ namespace tks
       overload
       {
         [](tks::Unknown)    -> std::string { return "<UNKNOWN_TK>";       },
+        [](tks::Error)      -> std::string { return "<ERROR_TK>";         },
         [](tks::Id t)       -> std::string { return std::format("<ID_TK: {}>", t.symbol); },
   
         [](tks::If)         -> std::string { return "<IF_TK>";            },
@@ -224,8 +253,8 @@ namespace tks
         [](tks::True)       -> std::string { return "<TRUE_TK>";          },
         [](tks::False)      -> std::string { return "<FALSE_TK>";         },
   
-        [](tks::IntNum t)     -> std::string { return std::format("<INTNUM_TK: {}>", t.value); },
-        [](tks::FloatNum t)   -> std::string { return std::format("<FLOATNUM_TK: {}>", t.value); },
+        [](tks::IntNum t)     -> std::string { return std::format("<INTNUM_TK: {}>", constants::pool()[t.literal].as_integer()); },
+        [](tks::FloatNum t)   -> std::string { return std::format("<FLOATNUM_TK: {}>", constants::pool()[t.literal].as_double()); },
   
         [](tks::ParanOpen)  -> std::string { return "<PARAN_OPEN_TK>";    },
         [](tks::ParanClose) -> std::string { return "<PARAN_CLOSE_TK>";   },
@@ -253,4 +282,14 @@ namespace tks
     );
   }
 
+  // Same kind, payload and position; tells whether a re-lex changed anything.
+  [[nodiscard]]
+  constexpr auto same(const Spanned& a, const Spanned& b) -> bool
+  {
+    return a.span.offset == b.span.offset
+       and a.span.length == b.span.length
+       and a.token.index() == b.token.index()
+       and to_string(a.token) == to_string(b.token);
+  }
+
 }
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "json.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Phase timings in Chrome's Trace Event Format (chrome://tracing, Perfetto).
+// Every thread appends to its own buffer, so recording takes no lock; the
+// registry lock is only taken the first time a thread records anything.
+// While tracing is off a Scope costs one relaxed load. A buffer keeps the
+// latest max_events of its thread, so a server, watcher or language server
+// that runs for days holds a bounded trace; older events are counted as
+// dropped and the count shows in the thread's name.
+namespace trace
+{
+
+  constexpr auto max_events = std::size_t{1} << 16;
+
+  struct Event
+  {
+    const char*  name;
+    std::int64_t start;    // ns since tracing was enabled
+    std::int64_t duration; // ns
+    std::int64_t arg;      // shown as "index" when not negative
+  };
+
+  namespace detail
+  {
+
+    struct Buffer
+    {
+      std::size_t        tid;
+      std::string        name;
+      std::vector<Event> events;      // a ring once it holds max_events
+      std::size_t        oldest  = 0; // where the ring starts
+      std::size_t        dropped = 0;
+
+      void record(const Event& event)
+      {
+        if (events.size() < max_events)
+        {
+          events.push_back(event);
+          return;
+        }
+        events[oldest] = event;
+        oldest = (oldest + 1) % max_events;
+        ++dropped;
+      }
+    };
+
+    inline auto enabled  = std::atomic<bool>{false};
+    inline auto origin   = std::chrono::steady_clock::time_point{};
+    inline auto registry = std::vector<std::shared_ptr<Buffer>>{};
+    inline auto registry_mutex = std::mutex{};
+
+    inline auto now() -> std::int64_t
+    {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    // Buffers outlive their threads, pool workers may exit before the write.
+    inline auto buffer() -> Buffer&
+    {
+      thread_local auto local = []
+      {
+        auto lock  = std::scoped_lock{registry_mutex};
+        auto fresh = std::make_shared<Buffer>(Buffer{.tid = registry.size(), .name = std::format("thread {}", registry.size()), .events = {}});
+        registry.push_back(fresh);
+        return fresh;
+      }();
+      return *local;
+    }
+
+  }
+
+  inline void enable()
+  {
+    detail::origin = std::chrono::steady_clock::now();
+    detail::enabled.store(true, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]]
+  inline auto enabled() -> bool
+  {
+    return detail::enabled.load(std::memory_order_relaxed);
+  }
+
+  // Label for the calling thread's row in the viewer.
+  inline void name_thread(std::string name)
+  {
+    if (enabled())
+    {
+      detail::buffer().name = std::move(name);
+    }
+  }
+
+  // Records the time between construction and destruction as one event.
+  class Scope
+  {
+  public:
+    explicit Scope(const char* name, std::int64_t arg = -1)
+      : name_{name}
+      , arg_{arg}
+      , start_{enabled() ? detail::now() : -1}
+    {
+    }
+
+    Scope(const Scope&)            = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    ~Scope()
+    {
+      if (start_ >= 0)
+      {
+        detail::buffer().record({.name = name_, .start = start_, .duration = detail::now() - start_, .arg = arg_});
+      }
+    }
+
+  private:
+    const char*  name_;
+    std::int64_t arg_;
+    std::int64_t start_;
+  };
+
+  // Call once every traced thread is done or idle.
+  inline auto write(const std::filesystem::path& path) -> std::expected<void, std::string>
+  {
+    auto events = json::Array{};
+    auto micros = [](std::int64_t ns) { return static_cast<double>(ns) / 1000.0; };
+
+    auto lock = std::scoped_lock{detail::registry_mutex};
+    for (const auto& buffer : detail::registry)
+    {
+      events.push_back(json::Object
+      {
+        {"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", buffer->tid},
+        {"args", json::Object{{"name", buffer->dropped == 0 ? buffer->name : std::format("{} ({} older events dropped)", buffer->name, buffer->dropped)}}}
+      });
+
+      for (auto index = std::size_t{0}; index < buffer->events.size(); ++index)
+      {
+        const auto& event = buffer->events[(buffer->oldest + index) % buffer->events.size()];
+        auto record = json::Object
+        {
+          {"name", event.name}, {"cat", "compiler"}, {"ph", "X"}, {"pid", 1}, {"tid", buffer->tid},
+          {"ts", micros(event.start)}, {"dur", micros(event.duration)}
+        };
+        if (event.arg >= 0)
+        {
+          record.emplace_back("args", json::Object{{"index", event.arg}});
+        }
+        events.push_back(std::move(record));
+      }
+    }
+
+    auto file = std::ofstream(path);
+    if (not file.is_open())
+    {
+      return std::unexpected(std::format("cannot open {}", path.string()));
+    }
+    file << json::dump(json::Object{{"traceEvents", std::move(events)}, {"displayTimeUnit", "ms"}});
+
+    return {};
+  }
+
+}
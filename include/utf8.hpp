@@ -0,0 +1,174 @@
+#pragma once
+
+#include "xid_tables.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace utf8
+{
+
+  // Code point at `index`, advancing `index` past it, or nullopt for an
+  // ill-formed sequence (overlong forms, surrogates, past U+10FFFF, cut off).
+  // `index` is left alone on failure.
+  constexpr auto decode(std::string_view text, std::size_t& index) -> std::optional<char32_t>
+  {
+    const auto byte = [&](std::size_t at) { return static_cast<unsigned char>(text[at]); };
+    const auto lead = byte(index);
+
+    if (lead < 0x80)
+    {
+      ++index;
+      return char32_t{lead};
+    }
+
+    auto length = std::size_t{0};
+    auto code   = char32_t{0};
+    auto lowest = char32_t{0};
+
+    if      ((lead & 0xE0) == 0xC0) { length = 2; code = lead & 0x1F; lowest = 0x80;    }
+    else if ((lead & 0xF0) == 0xE0) { length = 3; code = lead & 0x0F; lowest = 0x800;   }
+    else if ((lead & 0xF8) == 0xF0) { length = 4; code = lead & 0x07; lowest = 0x10000; }
+    else
+    {
+      return std::nullopt;
+    }
+
+    if (text.size() - index < length)
+    {
+      return std::nullopt;
+    }
+
+    for (auto k = std::size_t{1}; k < length; ++k)
+    {
+      if ((byte(index + k) & 0xC0) != 0x80)
+      {
+        return std::nullopt;
+      }
+      code = (code << 6) | (byte(index + k) & 0x3F);
+    }
+
+    if (code < lowest or code > 0x10FFFF or (code >= 0xD800 and code <= 0xDFFF))
+    {
+      return std::nullopt;
+    }
+
+    index += length;
+    return code;
+  }
+
+  // Whether `code` may follow the leading `_` of an identifier, for code
+  // points past ASCII; ASCII stays with the identifier recognizer's alphabet.
+  constexpr auto is_xid_continue(char32_t code) -> bool
+  {
+    const auto& table = tables::xid_continue;
+
+    const auto after = std::upper_bound(table.begin(), table.end(), code,
+        [](char32_t value, const auto& range) { return value < range.first; });
+
+    return after != table.begin() and code <= std::prev(after)->second;
+  }
+
+  namespace detail
+  {
+
+    // Length of the ASCII run at the start of `text`: sixteen bytes per step
+    // with SSE2, eight per step (SWAR) without it.
+    inline auto ascii_prefix(std::string_view text) -> std::size_t
+    {
+      auto index = std::size_t{0};
+
+#if defined(__SSE2__)
+      while (text.size() - index >= 16)
+      {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + index));
+        if (const auto high = _mm_movemask_epi8(block); high != 0)
+        {
+          return index + static_cast<std::size_t>(__builtin_ctz(static_cast<unsigned>(high)));
+        }
+        index += 16;
+      }
+#else
+      while (text.size() - index >= 8)
+      {
+        auto chunk = std::uint64_t{0};
+        std::memcpy(&chunk, text.data() + index, sizeof(chunk));
+        if ((chunk & 0x8080808080808080) != 0)
+        {
+          break;
+        }
+        index += 8;
+      }
+#endif
+
+      while (index < text.size() and static_cast<unsigned char>(text[index]) < 0x80)
+      {
+        ++index;
+      }
+      return index;
+    }
+
+  }
+
+  // Offset of the first byte that does not start a well-formed sequence, or
+  // nullopt when all of `text` is valid UTF-8. ASCII runs are skipped a
+  // vector at a time, only the multi-byte sequences are decoded one by one.
+  inline auto validate(std::string_view text) -> std::optional<std::size_t>
+  {
+    auto index = std::size_t{0};
+
+    while (true)
+    {
+      index += detail::ascii_prefix(text.substr(index));
+      if (index == text.size())
+      {
+        return std::nullopt;
+      }
+
+      while (index < text.size() and static_cast<unsigned char>(text[index]) >= 0x80)
+      {
+        if (not decode(text, index))
+        {
+          return index;
+        }
+      }
+    }
+  }
+
+  // `text` with every byte that is not part of a well-formed sequence
+  // written as \xNN, so it can be shown on a console or put in JSON.
+  inline auto escape(std::string_view text) -> std::string
+  {
+    constexpr auto hex = std::string_view{"0123456789ABCDEF"};
+
+    auto escaped = std::string{};
+    escaped.reserve(text.size());
+
+    for (auto index = std::size_t{0}; index < text.size(); )
+    {
+      const auto start = index;
+      if (decode(text, index))
+      {
+        escaped.append(text.substr(start, index - start));
+        continue;
+      }
+
+      const auto byte = static_cast<unsigned char>(text[index++]);
+      escaped += "\\x";
+      escaped += hex[byte >> 4];
+      escaped += hex[byte & 0xF];
+    }
+    return escaped;
+  }
+
+}
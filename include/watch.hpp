@@ -0,0 +1,356 @@
+#pragma once
+
+#include "interrupt.hpp"
+#include "options.hpp"
+#include "query.hpp"
+#include "source.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <print>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace watch
+{
+
+  namespace fs = std::filesystem;
+
+  namespace detail
+  {
+
+    // Quiet period that ends a burst of events (editors often write a file
+    // in several steps).
+    constant debounce = std::chrono::milliseconds{50};
+
+    constant events = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE;
+
+    enum struct Wake { Changed, Stopped, Failed };
+
+    // Editor swap and backup files are not sources.
+    inline auto is_source(const fs::path& path) -> bool
+    {
+      const auto name = path.filename().string();
+      return not name.empty() and not name.starts_with('.') and not name.ends_with('~');
+    }
+
+    inline auto is_within(const fs::path& directory, const fs::path& path) -> bool
+    {
+      const auto [end, _] = std::ranges::mismatch(directory, path);
+      return end == directory.end();
+    }
+
+  }
+
+  // Compiles every file under a directory once, then waits for inotify events
+  // and recompiles only the files that changed. Each output goes to
+  // out/<path relative to the directory> in the working directory. Tokens
+  // and outputs live in a query database, so a file whose bytes did not
+  // change (a plain save or touch) is not relexed.
+  class Watcher
+  {
+  public:
+    Watcher(fs::path root, cli::Options options)
+      : root_{fs::weakly_canonical(std::move(root))}
+      , output_root_{fs::weakly_canonical(fs::current_path()/"out")}
+      , options_{std::move(options)}
+      , database_{options_.max_errors}
+    {
+    }
+
+    Watcher(const Watcher&)            = delete;
+    Watcher& operator=(const Watcher&) = delete;
+
+    ~Watcher()
+    {
+      for (const auto fd : {fd_, stop_})
+      {
+        if (fd >= 0)
+        {
+          ::close(fd);
+        }
+      }
+    }
+
+    auto run() -> int
+    {
+      fd_   = ::inotify_init1(IN_CLOEXEC);
+      stop_ = interrupt::descriptor();
+      if (fd_ < 0 or not fs::is_directory(root_))
+      {
+        std::println("[Error] cannot watch {}: {}", root_.string(), fd_ < 0 ? std::strerror(errno) : "not a directory");
+        return EXIT_FAILURE;
+      }
+
+      auto changed = std::set<fs::path>{};
+      add_directory(root_, changed);
+      rebuild(changed);
+
+      std::println("[INFO] watching {} ({} file(s))", root_.string(), files_.size());
+
+      while (true)
+      {
+        changed.clear();
+        switch (wait(changed))
+        {
+          case detail::Wake::Changed:
+            rebuild(changed);
+            break;
+
+          case detail::Wake::Stopped:
+            std::println("[INFO] stopping");
+            return EXIT_SUCCESS;
+
+          case detail::Wake::Failed:
+            std::println("[Error] reading inotify events failed: {}", std::strerror(errno));
+            return EXIT_FAILURE;
+        }
+      }
+    }
+
+  private:
+    // Our own outputs land under out/, which may sit inside the watched tree.
+    auto is_output(const fs::path& path) const -> bool
+    {
+      return detail::is_within(output_root_, path);
+    }
+
+    auto ignored(const fs::path& path) const -> bool
+    {
+      return is_output(path) or not detail::is_source(path);
+    }
+
+    // Watches `directory` and everything below it, collecting the files found.
+    void add_directory(const fs::path& directory, std::set<fs::path>& found)
+    {
+      if (is_output(directory))
+      {
+        return;
+      }
+
+      const auto wd = ::inotify_add_watch(fd_, directory.c_str(), detail::events);
+      if (wd >= 0)
+      {
+        directories_.insert_or_assign(wd, directory);
+      }
+
+      auto ec = std::error_code{};
+      for (const auto& entry : fs::directory_iterator{directory, ec})
+      {
+        if (entry.is_directory())
+        {
+          add_directory(entry.path(), found);
+        }
+        else if (entry.is_regular_file() and not ignored(entry.path()))
+        {
+          found.insert(entry.path());
+        }
+      }
+    }
+
+    // Stops watching `directory` and everything below it. Its files go to
+    // `changed`, where compile() finds them gone and drops their sources and
+    // outputs; a directory moved elsewhere in the tree is re-added by its
+    // IN_MOVED_TO.
+    void remove_directory(const fs::path& directory, std::set<fs::path>& changed)
+    {
+      std::erase_if(directories_, [&](const auto& watched)
+      {
+        const auto& [wd, path] = watched;
+        if (not detail::is_within(directory, path))
+        {
+          return false;
+        }
+        ::inotify_rm_watch(fd_, wd);
+        return true;
+      });
+
+      for (const auto& file : files_)
+      {
+        if (detail::is_within(directory, file))
+        {
+          changed.insert(file);
+        }
+      }
+
+      auto ec = std::error_code{};
+      fs::remove_all(output_root_ / directory.lexically_relative(root_), ec);
+    }
+
+    // Blocks for the first event, then keeps draining until the directory
+    // has been quiet for the debounce period. SIGINT or SIGTERM end the wait.
+    auto wait(std::set<fs::path>& changed) -> detail::Wake
+    {
+      auto timeout = -1;
+
+      while (true)
+      {
+        auto ready = std::array
+        {
+          pollfd{.fd = fd_,   .events = POLLIN, .revents = 0},
+          pollfd{.fd = stop_, .events = POLLIN, .revents = 0}
+        };
+        const auto polled = ::poll(ready.data(), ready.size(), timeout);
+
+        if (polled < 0 and errno != EINTR)
+        {
+          return detail::Wake::Failed;
+        }
+        if (polled == 0)
+        {
+          return detail::Wake::Changed;
+        }
+        if (ready[1].revents != 0)
+        {
+          return detail::Wake::Stopped;
+        }
+        if (ready[0].revents == 0)
+        {
+          continue;
+        }
+
+        alignas(inotify_event) char buffer[64 * 1024];
+        const auto size = ::read(fd_, buffer, sizeof(buffer));
+        if (size < 0)
+        {
+          if (errno == EINTR or errno == EAGAIN)
+          {
+            continue;
+          }
+          return detail::Wake::Failed;
+        }
+
+        for (auto offset = ssize_t{0}; offset < size; )
+        {
+          const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+          offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+          const auto directory = directories_.find(event->wd);
+          if (directory == directories_.end() or event->len == 0)
+          {
+            continue;
+          }
+
+          const auto path = directory->second / event->name;
+          if (event->mask & IN_ISDIR)
+          {
+            if (event->mask & (IN_CREATE | IN_MOVED_TO))
+            {
+              add_directory(path, changed);
+            }
+            else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+            {
+              remove_directory(path, changed);
+            }
+          }
+          else if (not ignored(path))
+          {
+            changed.insert(path);
+          }
+        }
+
+        timeout = static_cast<int>(detail::debounce.count());
+      }
+    }
+
+    void rebuild(const std::set<fs::path>& changed)
+    {
+      const auto start    = std::chrono::steady_clock::now();
+      const auto ran      = database_.executions();
+      auto       compiled = std::size_t{0};
+
+      for (const auto& path : changed)
+      {
+        compiled += compile(path) ? 1 : 0;
+      }
+
+      if (compiled == 0)
+      {
+        return;
+      }
+
+      const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+      auto       errors  = std::size_t{0};
+      for (const auto& file : files_)
+      {
+        errors += database_.tokens(file.string()).errors;
+      }
+
+      std::println("[INFO] recompiled {} of {} file(s) in {:.2f} ms ({} queries rerun), {} error(s) in total",
+                   compiled, files_.size(), elapsed.count(), database_.executions() - ran, errors);
+      std::cout.flush();
+    }
+
+    // Returns whether anything was recompiled.
+    auto compile(const fs::path& path) -> bool
+    {
+      const auto relative = path.lexically_relative(root_);
+      const auto output   = output_root_ / relative;
+      const auto file     = path.string();
+
+      auto input_file = std::ifstream(path);
+      auto source     = std::expected<std::string, std::string>{std::unexpect, "removed"};
+      if (input_file.is_open())
+      {
+        source = src::read(input_file);
+      }
+
+      if (not source)
+      {
+        if (files_.erase(path) != 0)
+        {
+          database_.remove_source(file);
+
+          auto ec = std::error_code{};
+          fs::remove(output, ec);
+          std::println("[INFO] {}: {}", relative.string(), source.error());
+          return true;
+        }
+        return false;
+      }
+
+      files_.insert(path);
+      if (not database_.set_source(file, std::move(*source)))
+      {
+        return false;
+      }
+
+      auto ec = std::error_code{};
+      fs::create_directories(output.parent_path(), ec);
+
+      auto output_file = std::ofstream(output);
+      output_file << database_.output(file);
+
+      if (const auto& lexed = database_.tokens(file); lexed.errors != 0)
+      {
+        std::println("[INFO] {}:", relative.string());
+        std::print("{}", lexed.console);
+      }
+      return true;
+    }
+
+    fs::path                          root_;
+    fs::path                          output_root_;
+    cli::Options                      options_;
+    int                               fd_   = -1; // inotify
+    int                               stop_ = -1; // see interrupt::descriptor()
+    std::unordered_map<int, fs::path> directories_;
+    std::set<fs::path>                files_;
+    query::Database                   database_;
+  };
+
+}
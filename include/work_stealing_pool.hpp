@@ -0,0 +1,184 @@
+#pragma once
+
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <format>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace conc
+{
+
+  // Runs index-parallel loops on a fixed set of workers. Each loop deals its
+  // indices out in contiguous blocks, one deque per worker plus one for the
+  // calling thread, which helps instead of idling. A participant works from
+  // the front of its own deque and, once that is empty, steals from the back
+  // of the others', so uneven tasks even out without a central queue.
+  class WorkStealingPool
+  {
+  public:
+    explicit WorkStealingPool(std::size_t threads = std::thread::hardware_concurrency())
+    {
+      threads = std::max<std::size_t>(threads, 1);
+      workers_.reserve(threads);
+
+      for (auto i = std::size_t{0}; i < threads; ++i)
+      {
+        workers_.emplace_back([this, i] { work(i); });
+      }
+    }
+
+    WorkStealingPool(const WorkStealingPool&)            = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool()
+    {
+      {
+        auto lock = std::scoped_lock{mutex_};
+        stopping_ = true;
+      }
+      wake_.notify_all();
+    }
+
+    [[nodiscard]]
+    auto size() const -> std::size_t
+    {
+      return workers_.size();
+    }
+
+    // Calls body(i) for every i in [0, count) and returns once all are done.
+    template<typename Body>
+    void parallel_for(std::size_t count, Body&& body)
+    {
+      if (count == 0)
+      {
+        return;
+      }
+
+      auto run   = std::scoped_lock{run_mutex_};
+      auto batch = std::make_shared<Batch>(workers_.size() + 1);
+
+      const auto parts = batch->queues.size();
+      for (auto part = std::size_t{0}; part < parts; ++part)
+      {
+        for (auto index = part * count / parts; index < (part + 1) * count / parts; ++index)
+        {
+          batch->queues[part].items.push_back(index);
+        }
+      }
+      batch->task      = [&body](std::size_t index) { body(index); };
+      batch->remaining = count;
+
+      {
+        auto lock = std::scoped_lock{mutex_};
+        current_ = batch;
+        ++generation_;
+      }
+      wake_.notify_all();
+
+      drain(*batch, parts - 1);
+
+      auto lock = std::unique_lock{batch->mutex};
+      batch->done.wait(lock, [&] { return batch->remaining.load() == 0; });
+    }
+
+  private:
+    struct Queue
+    {
+      std::mutex              mutex;
+      std::deque<std::size_t> items;
+    };
+
+    // One parallel_for. Workers that wake late still hold the batch they saw,
+    // whose deques are empty by then, so they never run a stale task.
+    struct Batch
+    {
+      explicit Batch(std::size_t parts) : queues(parts) {}
+
+      std::vector<Queue>               queues;
+      std::function<void(std::size_t)> task;
+      std::atomic<std::size_t>         remaining = 0;
+      std::mutex                       mutex;
+      std::condition_variable          done;
+    };
+
+    static auto take(Batch& batch, std::size_t self) -> std::optional<std::size_t>
+    {
+      const auto parts = batch.queues.size();
+
+      for (auto k = std::size_t{0}; k < parts; ++k)
+      {
+        auto& queue = batch.queues[(self + k) % parts];
+        auto  lock  = std::scoped_lock{queue.mutex};
+
+        if (not queue.items.empty())
+        {
+          const auto own   = k == 0;
+          const auto index = own ? queue.items.front() : queue.items.back();
+          own ? queue.items.pop_front() : queue.items.pop_back();
+          return index;
+        }
+      }
+      return std::nullopt;
+    }
+
+    static void drain(Batch& batch, std::size_t self)
+    {
+      while (const auto index = take(batch, self))
+      {
+        batch.task(*index);
+
+        if (batch.remaining.fetch_sub(1) == 1)
+        {
+          auto lock = std::scoped_lock{batch.mutex};
+          batch.done.notify_all();
+        }
+      }
+    }
+
+    void work(std::size_t self)
+    {
+      if (trace::enabled())
+      {
+        trace::name_thread(std::format("worker {}", self));
+      }
+
+      auto seen = std::size_t{0};
+
+      while (true)
+      {
+        auto batch = std::shared_ptr<Batch>{};
+        {
+          auto lock = std::unique_lock{mutex_};
+          wake_.wait(lock, [&] { return stopping_ or generation_ != seen; });
+
+          if (stopping_)
+          {
+            return;
+          }
+          seen  = generation_;
+          batch = current_;
+        }
+        drain(*batch, self);
+      }
+    }
+
+    std::mutex                run_mutex_;
+    std::mutex                mutex_;
+    std::condition_variable   wake_;
+    std::shared_ptr<Batch>    current_;
+    std::size_t               generation_ = 0;
+    bool                      stopping_   = false;
+    std::vector<std::jthread> workers_;
+  };
+
+}
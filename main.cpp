@@ -1,5 +1,17 @@
 #include "include/analyzers.hpp"
+#include "include/callgraph.hpp"
+#include "include/diagnostics.hpp"
+#include "include/interrupt.hpp"
+#include "include/driver.hpp"
+#include "include/lsp.hpp"
+#include "include/memory.hpp"
+#include "include/options.hpp"
+#include "include/server.hpp"
+#include "include/source.hpp"
+#include "include/trace.hpp"
+#include "include/watch.hpp"
 #include <functional>
+#include <optional>
 #include <print>
 #include <fstream>
 #include <filesystem>
@@ -9,59 +21,225 @@ namespace fs = std::filesystem;
 namespace stdr = std::ranges;
 namespace stdv = std::views;
 
-auto main(int argc, char** argv) -> int 
+// Every allocation of the process goes through the counting allocator, so
+// --mem-report and --mem-limit see the whole heap. Without either flag it
+// is malloc and free with one extra branch.
+auto operator new(std::size_t size) -> void*
 {
-  if (argc <= 1)
+  if (auto* pointer = mem::allocate(size))
   {
-    std::println("  [INFO] Usage...");
-    std::println("    {} {}", argv[0], "code.txt");
-    return EXIT_FAILURE;
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+
+auto operator new(std::size_t size, std::align_val_t alignment) -> void*
+{
+  if (auto* pointer = mem::allocate(size, alignment))
+  {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+
+auto operator new[](std::size_t size) -> void*                             { return operator new(size); }
+auto operator new[](std::size_t size, std::align_val_t alignment) -> void* { return operator new(size, alignment); }
+
+void operator delete(void* pointer) noexcept                                  { mem::release(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept                     { mem::release(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept                { mem::release(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept   { mem::release(pointer); }
+void operator delete[](void* pointer) noexcept                                { mem::release(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept                   { mem::release(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept              { mem::release(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { mem::release(pointer); }
+
+// Queries pull tokens lazily and stop as soon as they have their answer;
+// they print to the console and leave out.txt alone.
+static auto run_query(cli::Query query, std::string_view source, diag::Sink& diagnostics) -> int
+{
+  switch (query)
+  {
+    case cli::Query::FirstError:
+      for (const auto& [token, span] : analyzer::tokens(source, diagnostics))
+      {
+        if (std::holds_alternative<tks::Error>(token))
+        {
+          break;
+        }
+      }
+      diagnostics.flush(std::cout);
+      return diagnostics.count() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    case cli::Query::CountProcs:
+      std::println("{}", stdr::count_if(analyzer::tokens(source, diagnostics), [](const tks::Spanned& t)
+      {
+        return std::holds_alternative<tks::Proc>(t.token);
+      }));
+      return EXIT_SUCCESS;
+
+    // Only reports the sites: there is no backend yet to turn them into jumps.
+    case cli::Query::TailCalls:
+    {
+      const auto tokens = analyzer::lex(source, diagnostics);
+      const auto graph  = callgraph::Graph{tokens, source};
+
+      auto sites = std::size_t{0};
+      for (const auto& proc : graph.procs())
+      {
+        for (const auto& call : proc.calls | stdv::filter(&callgraph::Call::tail))
+        {
+          const auto& callee     = graph.procs()[call.callee];
+          const auto [line, col] = diagnostics.location(tokens[call.site].span);
+
+          std::println("{} -> {} at line {}, column {}{}", proc.name, callee.name, line, col, &callee == &proc ? " (self)" : "");
+          ++sites;
+        }
+      }
+      std::println("[INFO] {} tail call(s).", sites);
+      return EXIT_SUCCESS;
+    }
+
+    case cli::Query::None:
+      break;
   }
-  else if(argc > 2)
+
+  return EXIT_FAILURE;
+}
+
+// Writes the trace and memory report, if asked for, once all the work is done.
+static auto finish(const cli::Options& options, int status) -> int
+{
+  if (options.mem_report)
+  {
+    mem::report(std::cout);
+  }
+
+  if (not options.trace.empty())
   {
+    if (auto written = trace::write(options.trace); not written)
+    {
+      std::println("[Error] trace cannot be written: {}", written.error());
+      return EXIT_FAILURE;
+    }
+  }
+  return status;
+}
+
+auto main(int argc, char** argv) -> int
+{
+  auto options = cli::parse_options(argc, argv);
+
+  if (not options)
+  {
+    std::println("  [Error] {}", options.error());
     std::println("  [INFO] Usage...");
-    std::println("    {} {}", argv[0], "code.txt");
+    std::println("    {} {}", argv[0], cli::usage);
     return EXIT_FAILURE;
   }
 
-  auto input_file  = std::ifstream(fs::path{argv[1]});
-  auto output_file = std::ofstream(fs::current_path()/"out.txt");
+  if (options->mem_report or options->mem_limit != 0)
+  {
+    mem::enable(options->mem_limit);
+  }
 
-  if(not output_file.is_open())
+  if (not options->trace.empty())
   {
-    std::println("[Error] output_file cannot be oppended !!");
-    return EXIT_FAILURE;
+    trace::enable();
+    trace::name_thread("main");
   }
 
+  // The long-running modes return from run() on `exit` (LSP) or on SIGINT
+  // and SIGTERM, and only then, with every worker joined, is the trace
+  // complete.
+  if (options->lsp)
+  {
+    const auto status = lsp::Server{std::cin, std::cout}.run();
+    return finish(*options, status);
+  }
+
+  if (not options->server.empty())
+  {
+    interrupt::block();
+    const auto status = server::Server{*options}.run(options->server);
+    return finish(*options, status);
+  }
+
+  if (not options->watch.empty())
+  {
+    interrupt::block();
+    const auto status = watch::Watcher{options->watch, *options}.run();
+    return finish(*options, status);
+  }
+
+  if (not options->client.empty())
+  {
+    auto client = server::Client::connect(options->client);
+    if (not client)
+    {
+      std::println("[Error] {}", client.error());
+      return EXIT_FAILURE;
+    }
+
+    auto reply = client->compile(options->input, *options);
+    if (not reply)
+    {
+      std::println("[Error] {}", reply.error());
+      return EXIT_FAILURE;
+    }
+
+    if (not reply->out.empty())
+    {
+      auto output_file = std::ofstream(fs::current_path()/"out.txt");
+      output_file << reply->out;
+    }
+    std::print("{}", reply->console);
+
+    return reply->status;
+  }
+
+  // One-shot runs record their phases here; finish() prints them.
+  auto ledger = std::optional<mem::Ledger>{};
+  if (options->mem_report)
+  {
+    ledger.emplace();
+  }
+
+  auto input_file = std::ifstream(options->input);
   if(not input_file.is_open())
   {
     std::println("[Error] input_file cannot be oppended !!");
     return EXIT_FAILURE;
   }
 
-  auto line = std::string{};
-  line.reserve(256);
+  auto source = [&]
+  {
+    auto scope = trace::Scope{"read"};
+    auto phase = mem::Phase{"read"};
+    return src::read(input_file);
+  }();
+
+  if(not source)
+  {
+    std::println("[Error] input_file cannot be read: {}", source.error());
+    return EXIT_FAILURE;
+  }
 
-  auto line_counter = std::size_t{0};
-  while (std::getline(input_file, line))
+  if (options->query != cli::Query::None)
   {
-    ++line_counter;
+    const auto lines = src::LineIndex{*source};
+    auto diagnostics = diag::Sink{options->max_errors, lines};
 
-    auto parse_bound = [line_counter](const std::string& s)
-    { 
-      return analyzer::parse_all(s, line_counter);
-    };
+    return finish(*options, run_query(options->query, *source, diagnostics));
+  }
 
-    auto lexeme_pipeline = line 
-                         | stdv::split(' ')
-                         | stdv::filter([](auto&& r){ return not stdr::empty(r); })
-                         | stdv::transform([](auto&& r){ return std::string(stdr::begin(r), stdr::end(r));})
-                         | stdv::transform(parse_bound)
-                         | stdv::join_with(' ')
-                         | stdr::to<std::string>();
+  auto output_file = std::ofstream(fs::current_path()/"out.txt");
 
-    std::println(output_file, "{}", lexeme_pipeline);
+  if(not output_file.is_open())
+  {
+    std::println("[Error] output_file cannot be oppended !!");
+    return EXIT_FAILURE;
   }
 
-  return EXIT_SUCCESS;
+  return finish(*options, driver::compile(*source, output_file, std::cout, *options));
 }
@@ -0,0 +1,52 @@
+// Compile-time checks on embedded::script: `make check` only compiles this
+// file, so any drift between the build-time lexer and analyzer::lex stops
+// the build instead of shipping.
+
+#include "../include/embedded.hpp"
+#include "../include/tokens.hpp"
+
+#include <cstddef>
+#include <variant>
+
+namespace
+{
+
+  constexpr auto& script = embedded::script<"proc _main ( )\n{\n  var _x : int <- 42\n  _x <- _x + 42\n  return _x\n}\n_y 99999999999999999999999 1.5 va \xff">;
+
+  template<typename T>
+  constexpr auto is(std::size_t index) -> bool
+  {
+    return std::holds_alternative<T>(script.tokens[index].token);
+  }
+
+  constexpr auto symbol(std::size_t index) -> std::uint32_t
+  {
+    return std::get<tks::Id>(script.tokens[index].token).symbol;
+  }
+
+  constexpr auto fault(std::size_t index) -> tks::Fault
+  {
+    return std::get<tks::Error>(script.tokens[index].token).fault;
+  }
+
+}
+
+static_assert(script.tokens.size() == 24);
+
+static_assert(is<tks::Proc>(0) and is<tks::Var>(5) and is<tks::Int>(8) and is<tks::Plus>(14) and is<tks::Return>(16));
+
+// Symbols are numbered from 1 in order of first appearance.
+static_assert(symbol(1) == 1 and symbol(6) == 2 and symbol(11) == 2 and symbol(13) == 2 and symbol(17) == 2 and symbol(19) == 3);
+
+// Equal literals share an entry of the script's own table.
+static_assert(is<tks::IntNum>(10) and is<tks::IntNum>(15));
+static_assert(std::get<tks::IntNum>(script.tokens[10].token).literal == std::get<tks::IntNum>(script.tokens[15].token).literal);
+static_assert(script.value(std::get<tks::IntNum>(script.tokens[10].token)) == 42);
+static_assert(script.value(std::get<tks::FloatNum>(script.tokens[21].token)) == 1.5);
+
+// Errors carry the fault analyzer::lex gives the same lexeme.
+static_assert(fault(20) == tks::Fault::OutOfRange);
+static_assert(fault(22) == tks::Fault::UnknownLexeme);
+static_assert(fault(23) == tks::Fault::InvalidEncoding);
+
+static_assert(script.tokens[6].span.offset == 23 and script.tokens[6].span.length == 2);
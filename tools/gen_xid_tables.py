@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+"""Writes include/xid_tables.hpp: the non-ASCII code points that may follow
+the leading `_` of an identifier (Unicode XID_Continue).
+
+Python's str.isidentifier() implements XID_Start/XID_Continue, so the table
+follows the Unicode version of the interpreter that runs this script.
+
+    python3 tools/gen_xid_tables.py > include/xid_tables.hpp
+"""
+
+import sys
+import unicodedata
+
+
+def ranges():
+    first = None
+    for code in range(0x80, sys.maxunicode + 2):
+        inside = code <= sys.maxunicode and ("_" + chr(code)).isidentifier()
+        if inside and first is None:
+            first = code
+        elif not inside and first is not None:
+            yield first, code - 1
+            first = None
+
+
+def main():
+    table = list(ranges())
+    per_line = 4
+
+    print("#pragma once")
+    print()
+    print("// Generated by tools/gen_xid_tables.py from Unicode "
+          f"{unicodedata.unidata_version}, do not edit.")
+    print()
+    print("#include <array>")
+    print("#include <utility>")
+    print()
+    print("namespace utf8::tables")
+    print("{")
+    print()
+    print("  // Inclusive, sorted, non-overlapping ranges of non-ASCII XID_Continue code points.")
+    print(f"  inline constexpr auto xid_continue = std::array<std::pair<char32_t, char32_t>, {len(table)}>")
+    print("  {{")
+    for start in range(0, len(table), per_line):
+        row = ", ".join(f"{{0x{a:05X}, 0x{b:05X}}}" for a, b in table[start:start + per_line])
+        print(f"    {row},")
+    print("  }};")
+    print()
+    print("}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,119 @@
+// Load test for `app --server`: opens N concurrent connections, each sending
+// R requests that cycle through the given files, and reports the latency
+// distribution of the round trips.
+//
+//   loadtest socket clients requests code.txt [more.txt ...]
+
+#include "../include/server.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <print>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace chr = std::chrono;
+
+static auto count(std::string_view text) -> std::size_t
+{
+  auto value = std::size_t{};
+  auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+  return ec == std::errc{} and ptr == text.data() + text.size() ? value : 0;
+}
+
+// Nearest-rank percentile of already sorted samples.
+static auto percentile(std::span<const chr::nanoseconds> sorted, double p) -> chr::nanoseconds
+{
+  const auto rank = static_cast<std::size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.5);
+  return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+}
+
+static auto micros(chr::nanoseconds d) -> double
+{
+  return chr::duration<double, std::micro>(d).count();
+}
+
+auto main(int argc, char** argv) -> int
+{
+  const auto args = std::span{argv, static_cast<std::size_t>(argc)};
+
+  const auto clients  = args.size() > 2 ? count(args[2]) : 0;
+  const auto requests = args.size() > 3 ? count(args[3]) : 0;
+
+  if (args.size() < 5 or clients == 0 or requests == 0)
+  {
+    std::println("  [INFO] Usage...");
+    std::println("    {} socket clients requests code.txt [more.txt ...]", args[0]);
+    return EXIT_FAILURE;
+  }
+
+  const auto socket = std::filesystem::path{args[1]};
+  const auto files  = std::vector<std::filesystem::path>(args.begin() + 4, args.end());
+
+  auto latencies = std::vector<std::vector<chr::nanoseconds>>(clients);
+  auto failures  = std::atomic<std::size_t>{0};
+
+  const auto start = chr::steady_clock::now();
+  {
+    auto threads = std::vector<std::jthread>{};
+    threads.reserve(clients);
+
+    for (auto c = std::size_t{0}; c < clients; ++c)
+    {
+      threads.emplace_back([&, c]
+      {
+        auto client = server::Client::connect(socket);
+        if (not client)
+        {
+          std::println("[Error] {}", client.error());
+          failures += requests;
+          return;
+        }
+
+        auto& samples = latencies[c];
+        samples.reserve(requests);
+
+        for (auto r = std::size_t{0}; r < requests; ++r)
+        {
+          const auto sent  = chr::steady_clock::now();
+          const auto reply = client->compile(files[(c + r) % files.size()], cli::Options{});
+
+          if (not reply)
+          {
+            std::println("[Error] {}", reply.error());
+            failures += requests - r;
+            return;
+          }
+          samples.push_back(chr::steady_clock::now() - sent);
+        }
+      });
+    }
+  }
+  const auto elapsed = chr::steady_clock::now() - start;
+
+  auto all = std::vector<chr::nanoseconds>{};
+  for (const auto& samples : latencies)
+  {
+    all.insert(all.end(), samples.begin(), samples.end());
+  }
+  std::ranges::sort(all);
+
+  if (all.empty())
+  {
+    std::println("[Error] no request succeeded");
+    return EXIT_FAILURE;
+  }
+
+  std::println("requests   {} ({} failed) from {} client(s)", all.size(), failures.load(), clients);
+  std::println("throughput {:.0f} req/s", static_cast<double>(all.size()) / chr::duration<double>(elapsed).count());
+  std::println("latency    p50 {:.1f} us, p99 {:.1f} us, max {:.1f} us",
+               micros(percentile(all, 50)), micros(percentile(all, 99)), micros(all.back()));
+
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}